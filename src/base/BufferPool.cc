@@ -0,0 +1,85 @@
+#include "base/BufferPool.h"
+#include "base/CurrentThread.h"
+
+BufferPool::BufferPool(size_t maxCachedBytesPerClass):
+    ownerTid_(CurrentThread::tid()),
+    maxCachedBytesPerClass_(maxCachedBytesPerClass),
+    hits_(0),
+    misses_(0),
+    cachedBytes_(0)
+{
+}
+
+BufferPool::~BufferPool()
+{
+    for(std::vector<char*>& freeList: freeLists_)
+    {
+        for(char* block: freeList)
+        {
+            delete[] block;
+        }
+    }
+}
+
+int BufferPool::classOf(size_t size)
+{
+    for(int cls = 0; cls < kNumClasses; cls++)
+    {
+        if(size <= classSize(cls))
+        {
+            return cls;
+        }
+    }
+    return -1;
+}
+
+size_t BufferPool::roundUp(size_t size)
+{
+    int cls = classOf(size);
+    return cls < 0 ? size : classSize(cls);
+}
+
+bool BufferPool::inOwnerThread() const
+{
+    return CurrentThread::tid() == ownerTid_;
+}
+
+char *BufferPool::allocate(BufferPool *pool, size_t size, size_t *capacity)
+{
+    int cls = classOf(size);
+    *capacity = cls < 0 ? size : classSize(cls);
+    if(cls >= 0 && pool && pool->inOwnerThread())
+    {
+        std::vector<char*>& freeList = pool->freeLists_[cls];
+        if(!freeList.empty())
+        {
+            char* block = freeList.back();
+            freeList.pop_back();
+            add(pool->hits_, 1);
+            add(pool->cachedBytes_, -static_cast<int64_t>(*capacity));
+            return block;
+        }
+        add(pool->misses_, 1);
+    }
+    return new char[*capacity];
+}
+
+void BufferPool::deallocate(BufferPool *pool, char *block, size_t capacity)
+{
+    if(block == nullptr)
+    {
+        return;
+    }
+    int cls = classOf(capacity);
+    if(cls >= 0 && classSize(cls) == capacity && pool && pool->inOwnerThread())
+    {
+        std::vector<char*>& freeList = pool->freeLists_[cls];
+        if((freeList.size() + 1) * capacity <= pool->maxCachedBytesPerClass_)
+        {
+            freeList.push_back(block);
+            add(pool->cachedBytes_, static_cast<int64_t>(capacity));
+            return;
+        }
+    }
+    delete[] block;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "base/noncopyable.h"
+
+#include <atomic>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+/// @brief 按大小分级缓存内存块的池，每个EventLoop拥有一个，供Buffer/ChainBuffer使用。
+/// 第i级的块大小为kClassOverhead + (kMinClassPayload << i)，即能容纳Buffer的预留头部与2的幂次的数据。
+/// 超过最大级别的请求直接从堆上分配与释放。
+/// 只有创建池的线程（loop线程）会访问空闲链表；其他线程的分配与释放直接使用堆，
+/// 由于池中的块也是用new[]分配的，两者可以混用。
+class BufferPool: noncopyable
+{
+public:
+    static const size_t kClassOverhead = 8;
+    static const size_t kMinClassPayload = 1024;
+    static const int kNumClasses = 11;  /* 1KB ~ 1MB */
+    static const size_t kDefaultMaxCachedBytes = 4 * 1024 * 1024;
+
+    /// @param maxCachedBytesPerClass 每一级最多缓存的字节数，超出的块直接释放
+    explicit BufferPool(size_t maxCachedBytesPerClass = kDefaultMaxCachedBytes);
+    ~BufferPool();
+
+    /// @brief 分配不小于size字节的块，实际大小写入*capacity
+    /// @param pool 为nullptr时直接从堆上分配
+    static char* allocate(BufferPool* pool, size_t size, size_t* capacity);
+    /// @brief 释放allocate返回的块，capacity必须是allocate返回的大小
+    static void deallocate(BufferPool* pool, char* block, size_t capacity);
+
+    /// @brief 不小于size的级别大小，超过最大级别时返回size
+    static size_t roundUp(size_t size);
+
+    /// 以下计数可以被其他线程读取
+    int64_t hits() const { return hits_.load(std::memory_order_relaxed); }
+    int64_t misses() const { return misses_.load(std::memory_order_relaxed); }
+    /// @brief 当前缓存在池中的字节数
+    int64_t cachedBytes() const { return cachedBytes_.load(std::memory_order_relaxed); }
+
+private:
+    /// @brief size所属的级别，超过最大级别时返回-1
+    static int classOf(size_t size);
+    static size_t classSize(int cls) { return kClassOverhead + (kMinClassPayload << cls); }
+
+    bool inOwnerThread() const;
+
+    /// 只有所属线程写入，不需要原子的读-改-写
+    static void add(std::atomic<int64_t>& counter, int64_t n)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    const int ownerTid_;
+    const size_t maxCachedBytesPerClass_;
+    std::vector<char*> freeLists_[kNumClasses];
+    std::atomic<int64_t> hits_;
+    std::atomic<int64_t> misses_;
+    std::atomic<int64_t> cachedBytes_;
+};
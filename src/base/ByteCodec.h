@@ -0,0 +1,270 @@
+#pragma once
+
+#include "base/StringPiece.h"
+
+#include <type_traits>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/// @brief 二进制协议的编解码原语：指定字节序的定长整数，LEB128变长整数(varint)，
+/// 以及在一段连续内存上顺序读写的ByteReader/ByteWriter。
+/// 全部为内联函数，读写都是一次memcpy（编译为一条load/store）加上必要的字节交换
+namespace ByteCodec
+{
+    /// uint64_t的varint最多10个字节
+    const size_t kMaxVarintLength = 10;
+
+    inline uint8_t byteSwapUnsigned(uint8_t v) { return v; }
+    inline uint16_t byteSwapUnsigned(uint16_t v) { return __builtin_bswap16(v); }
+    inline uint32_t byteSwapUnsigned(uint32_t v) { return __builtin_bswap32(v); }
+    inline uint64_t byteSwapUnsigned(uint64_t v) { return __builtin_bswap64(v); }
+
+    template<typename T>
+    T byteSwap(T v)
+    {
+        static_assert(std::is_integral<T>::value, "integer types only");
+        using U = typename std::make_unsigned<T>::type;
+        return static_cast<T>(byteSwapUnsigned(static_cast<U>(v)));
+    }
+
+    template<typename T>
+    T loadLE(const char* p)
+    {
+        T v;
+        ::memcpy(&v, p, sizeof v);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        v = byteSwap(v);
+#endif
+        return v;
+    }
+
+    template<typename T>
+    T loadBE(const char* p)
+    {
+        T v;
+        ::memcpy(&v, p, sizeof v);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        v = byteSwap(v);
+#endif
+        return v;
+    }
+
+    template<typename T>
+    void storeLE(char* p, T v)
+    {
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        v = byteSwap(v);
+#endif
+        ::memcpy(p, &v, sizeof v);
+    }
+
+    template<typename T>
+    void storeBE(char* p, T v)
+    {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        v = byteSwap(v);
+#endif
+        ::memcpy(p, &v, sizeof v);
+    }
+
+    /// @brief 编码varint，p处至少要有kMaxVarintLength字节的空间
+    /// @return 编码结束的位置
+    inline char* encodeVarint(char* p, uint64_t v)
+    {
+        while(v >= 0x80)
+        {
+            *p++ = static_cast<char>(v | 0x80);
+            v >>= 7;
+        }
+        *p++ = static_cast<char>(v);
+        return p;
+    }
+
+    inline size_t varintLength(uint64_t v)
+    {
+        size_t len = 1;
+        while(v >= 0x80)
+        {
+            v >>= 7;
+            ++len;
+        }
+        return len;
+    }
+
+    /// @brief 从[p, end)解码varint
+    /// @return 消耗的字节数；数据不完整返回0；超过10个字节或超出64位返回-1
+    inline int decodeVarint(const char* p, const char* end, uint64_t* v)
+    {
+        uint64_t result = 0;
+        for(int i = 0; i < static_cast<int>(kMaxVarintLength); i++)
+        {
+            if(p + i >= end)
+            {
+                return 0;
+            }
+            uint8_t byte = static_cast<uint8_t>(p[i]);
+            if(i == static_cast<int>(kMaxVarintLength) - 1 && byte > 1)
+            {
+                return -1;
+            }
+            result |= static_cast<uint64_t>(byte & 0x7f) << (7 * i);
+            if(byte < 0x80)
+            {
+                *v = result;
+                return i + 1;
+            }
+        }
+        return -1;
+    }
+
+    /// zigzag编码使绝对值小的负数也只占很少的字节
+    inline uint64_t zigzagEncode(int64_t v)
+    {
+        return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+    }
+    inline int64_t zigzagDecode(uint64_t v)
+    {
+        return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+    }
+
+    /// @brief 在[data, data + size)上顺序解码。每次读取都检查剩余长度，
+    /// 越界或格式错误时置为失败状态，之后的读取都返回0或空视图，最后只需检查一次ok()。
+    /// 可以先用has(n)一次性确认定长头部的长度
+    ///
+    /// @code
+    ///   ByteCodec::ByteReader reader = buf->reader();
+    ///   uint32_t type = reader.readBE<uint32_t>();
+    ///   uint64_t len = reader.readVarint();
+    ///   StringPiece body = reader.readView(len);
+    ///   if(reader.incomplete()) return;   // 等待更多数据
+    ///   if(!reader.ok()) { /* 协议错误 */ }
+    ///   buf->retrieve(reader.consumed());
+    /// @endcode
+    class ByteReader
+    {
+    public:
+        ByteReader(const char* data, size_t size):
+            begin_(data),
+            cur_(data),
+            end_(data + size),
+            state_(kOk)
+        {}
+
+        bool ok() const { return state_ == kOk; }
+        /// @brief 是否因为数据不够而失败（格式错误不算）
+        bool incomplete() const { return state_ == kIncomplete; }
+        bool malformed() const { return state_ == kMalformed; }
+        size_t consumed() const { return cur_ - begin_; }
+        size_t remaining() const { return end_ - cur_; }
+        bool has(size_t n) const { return ok() && remaining() >= n; }
+
+        template<typename T>
+        T readBE()
+        {
+            return take(sizeof(T)) ? loadBE<T>(cur_ - sizeof(T)) : T();
+        }
+
+        template<typename T>
+        T readLE()
+        {
+            return take(sizeof(T)) ? loadLE<T>(cur_ - sizeof(T)) : T();
+        }
+
+        uint64_t readVarint()
+        {
+            uint64_t v = 0;
+            if(!ok())
+            {
+                return 0;
+            }
+            int n = decodeVarint(cur_, end_, &v);
+            if(n <= 0)
+            {
+                state_ = n == 0 ? kIncomplete : kMalformed;
+                return 0;
+            }
+            cur_ += n;
+            return v;
+        }
+
+        int64_t readVarintSigned() { return zigzagDecode(readVarint()); }
+
+        /// @brief 不复制地读取len字节，视图与底层数据的生命周期相同
+        StringPiece readView(size_t len)
+        {
+            return take(len) ? StringPiece(cur_ - len, len) : StringPiece();
+        }
+
+        void skip(size_t len) { take(len); }
+
+    private:
+        enum State { kOk, kIncomplete, kMalformed };
+
+        bool take(size_t n)
+        {
+            if(!has(n))
+            {
+                if(ok())
+                {
+                    state_ = kIncomplete;
+                }
+                return false;
+            }
+            cur_ += n;
+            return true;
+        }
+
+        const char* begin_;
+        const char* cur_;
+        const char* end_;
+        State state_;
+    };
+
+    /// @brief 在预留好的内存上顺序编码，不检查边界，调用者负责预留足够的空间
+    /// （定长字段之和加上每个varint的kMaxVarintLength）
+    ///
+    /// @code
+    ///   ByteCodec::ByteWriter writer(buf->beginAppend(64));
+    ///   writer.writeBE<uint32_t>(type);
+    ///   writer.writeVarint(body.size());
+    ///   buf->commitAppend(writer.size());
+    /// @endcode
+    class ByteWriter
+    {
+    public:
+        explicit ByteWriter(char* data):
+            begin_(data),
+            cur_(data)
+        {}
+
+        size_t size() const { return cur_ - begin_; }
+
+        template<typename T>
+        void writeBE(T v)
+        {
+            storeBE(cur_, v);
+            cur_ += sizeof(T);
+        }
+
+        template<typename T>
+        void writeLE(T v)
+        {
+            storeLE(cur_, v);
+            cur_ += sizeof(T);
+        }
+
+        void writeVarint(uint64_t v) { cur_ = encodeVarint(cur_, v); }
+        void writeVarintSigned(int64_t v) { writeVarint(zigzagEncode(v)); }
+
+        void write(const void* data, size_t len)
+        {
+            ::memcpy(cur_, data, len);
+            cur_ += len;
+        }
+
+    private:
+        char* begin_;
+        char* cur_;
+    };
+}
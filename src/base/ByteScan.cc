@@ -0,0 +1,288 @@
+#include "base/ByteScan.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define MUDUO_BYTESCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+/// findAny的向量实现最多逐个比较的字节数，更大的集合使用查表
+const size_t kMaxVectorSet = 16;
+
+const char* findByteScalar(const char* begin, const char* end, char c)
+{
+    for(const char* p = begin; p < end; ++p)
+    {
+        if(*p == c)
+        {
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+const char* findAnyTable(const char* begin, const char* end, const char* set, size_t setLen)
+{
+    bool table[256];
+    ::memset(table, 0, sizeof table);
+    for(size_t i = 0; i < setLen; i++)
+    {
+        table[static_cast<unsigned char>(set[i])] = true;
+    }
+    for(const char* p = begin; p < end; ++p)
+    {
+        if(table[static_cast<unsigned char>(*p)])
+        {
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+/// 小集合逐个比较，避免每次调用都初始化查找表（向量实现的尾部也使用它）
+const char* findAnySmall(const char* begin, const char* end, const char* set, size_t setLen)
+{
+    for(const char* p = begin; p < end; ++p)
+    {
+        for(size_t i = 0; i < setLen; i++)
+        {
+            if(*p == set[i])
+            {
+                return p;
+            }
+        }
+    }
+    return nullptr;
+}
+
+const char* findAnyScalar(const char* begin, const char* end, const char* set, size_t setLen)
+{
+    // 查找表的初始化只在较长的输入上划算
+    if(setLen <= kMaxVectorSet && end - begin <= 64)
+    {
+        return findAnySmall(begin, end, set, setLen);
+    }
+    return findAnyTable(begin, end, set, setLen);
+}
+
+const char* findCRLFScalar(const char* begin, const char* end)
+{
+    for(const char* p = begin; p + 1 < end; ++p)
+    {
+        if(p[0] == '\r' && p[1] == '\n')
+        {
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+#ifdef MUDUO_BYTESCAN_X86
+// SSE2每次处理16字节，AVX2每次处理32字节。'\r\n'需要同时比较p与p+1开始的两个向量，
+// 尾部不足一个向量的部分交给更窄的实现
+
+/// 单字节查找直接使用memchr：glibc已经按CPU选择了向量化的实现，比这里的循环更快
+const char* findByteMemchr(const char* begin, const char* end, char c)
+{
+    return static_cast<const char*>(::memchr(begin, c, end - begin));
+}
+
+const char* findAnySse2(const char* begin, const char* end, const char* set, size_t setLen)
+{
+    if(setLen > kMaxVectorSet)
+    {
+        return findAnyTable(begin, end, set, setLen);
+    }
+    __m128i needles[kMaxVectorSet];
+    for(size_t i = 0; i < setLen; i++)
+    {
+        needles[i] = _mm_set1_epi8(set[i]);
+    }
+    const char* p = begin;
+    for(; p + 16 <= end; p += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i hit = _mm_setzero_si128();
+        for(size_t i = 0; i < setLen; i++)
+        {
+            hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, needles[i]));
+        }
+        int mask = _mm_movemask_epi8(hit);
+        if(mask != 0)
+        {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return findAnySmall(p, end, set, setLen);
+}
+
+const char* findCRLFSse2(const char* begin, const char* end)
+{
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i lf = _mm_set1_epi8('\n');
+    const char* p = begin;
+    for(; p + 17 <= end; p += 16)
+    {
+        __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+        int mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, cr), _mm_cmpeq_epi8(second, lf)));
+        if(mask != 0)
+        {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return findCRLFScalar(p, end);
+}
+
+__attribute__((target("avx2")))
+const char* findAnyAvx2(const char* begin, const char* end, const char* set, size_t setLen)
+{
+    if(setLen > kMaxVectorSet)
+    {
+        return findAnyTable(begin, end, set, setLen);
+    }
+    __m256i needles[kMaxVectorSet];
+    for(size_t i = 0; i < setLen; i++)
+    {
+        needles[i] = _mm256_set1_epi8(set[i]);
+    }
+    const char* p = begin;
+    for(; p + 32 <= end; p += 32)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i hit = _mm256_setzero_si256();
+        for(size_t i = 0; i < setLen; i++)
+        {
+            hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, needles[i]));
+        }
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hit));
+        if(mask != 0)
+        {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    // 转入SSE实现前清除ymm寄存器的高位，否则混用SSE指令会有很大的切换开销
+    _mm256_zeroupper();
+    return findAnySse2(p, end, set, setLen);
+}
+
+__attribute__((target("avx2")))
+const char* findCRLFAvx2(const char* begin, const char* end)
+{
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i lf = _mm256_set1_epi8('\n');
+    const char* p = begin;
+    for(; p + 33 <= end; p += 32)
+    {
+        __m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i second = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(first, cr), _mm256_cmpeq_epi8(second, lf))));
+        if(mask != 0)
+        {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    _mm256_zeroupper();
+    return findCRLFSse2(p, end);
+}
+#endif
+
+struct Kernels
+{
+    ByteScan::Isa isa;
+    const char* (*findByte)(const char*, const char*, char);
+    const char* (*findAny)(const char*, const char*, const char*, size_t);
+    const char* (*findCRLF)(const char*, const char*);
+};
+
+bool supported(ByteScan::Isa isa)
+{
+    switch(isa)
+    {
+    case ByteScan::kScalar:
+        return true;
+#ifdef MUDUO_BYTESCAN_X86
+    case ByteScan::kSse2:
+        return true;
+    case ByteScan::kAvx2:
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+Kernels kernelsFor(ByteScan::Isa isa)
+{
+    switch(isa)
+    {
+#ifdef MUDUO_BYTESCAN_X86
+    case ByteScan::kAvx2:
+        return Kernels{ByteScan::kAvx2, findByteMemchr, findAnyAvx2, findCRLFAvx2};
+    case ByteScan::kSse2:
+        return Kernels{ByteScan::kSse2, findByteMemchr, findAnySse2, findCRLFSse2};
+#endif
+    default:
+        return Kernels{ByteScan::kScalar, findByteScalar, findAnyScalar, findCRLFScalar};
+    }
+}
+
+/// 第一次使用时选择CPU支持的最快实现
+Kernels& kernels()
+{
+    static Kernels k = kernelsFor(supported(ByteScan::kAvx2) ? ByteScan::kAvx2 :
+                                  supported(ByteScan::kSse2) ? ByteScan::kSse2 : ByteScan::kScalar);
+    return k;
+}
+}
+
+const char* ByteScan::findByte(const char* begin, const char* end, char c)
+{
+    return kernels().findByte(begin, end, c);
+}
+
+const char* ByteScan::findAny(const char* begin, const char* end, const char* set, size_t setLen)
+{
+    if(setLen == 0)
+    {
+        return nullptr;
+    }
+    return kernels().findAny(begin, end, set, setLen);
+}
+
+const char* ByteScan::findCRLF(const char* begin, const char* end)
+{
+    return kernels().findCRLF(begin, end);
+}
+
+ByteScan::Isa ByteScan::isa()
+{
+    return kernels().isa;
+}
+
+const char* ByteScan::isaName(Isa isa)
+{
+    switch(isa)
+    {
+    case kAvx2:
+        return "avx2";
+    case kSse2:
+        return "sse2";
+    default:
+        return "scalar";
+    }
+}
+
+bool ByteScan::setIsa(Isa isa)
+{
+    if(!supported(isa))
+    {
+        return false;
+    }
+    kernels() = kernelsFor(isa);
+    return true;
+}
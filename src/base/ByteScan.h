@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stddef.h>
+
+/// @brief 在字节序列中查找分隔符的向量化实现，供Buffer与文本协议的编解码使用。
+/// x86-64上根据CPU在运行时选择AVX2或SSE2实现，其他平台使用标量实现。
+/// 所有函数在[begin, end)中查找，找不到时返回nullptr
+namespace ByteScan
+{
+    enum Isa
+    {
+        kScalar,
+        kSse2,
+        kAvx2
+    };
+
+    /// @brief 第一个等于c的字节
+    const char* findByte(const char* begin, const char* end, char c);
+
+    /// @brief 第一个属于set[0, setLen)的字节
+    const char* findAny(const char* begin, const char* end, const char* set, size_t setLen);
+
+    /// @brief 第一个"\r\n"中'\r'的位置
+    const char* findCRLF(const char* begin, const char* end);
+
+    /// @brief 当前使用的实现
+    Isa isa();
+    const char* isaName(Isa isa);
+
+    /// @brief 强制使用指定的实现（用于测试与性能对比）
+    /// @return CPU不支持该实现时返回false，当前实现不变
+    bool setIsa(Isa isa);
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "base/SmallTask.h"
+
 #include <memory>
 #include <functional>
 
@@ -28,7 +30,7 @@ using CloseCallback = std::function<void(const TcpConnectionPtr &)>;
 using WriteCompleteCallback = std::function<void(const TcpConnectionPtr &)>;
 using HighWaterMarkCallback = std::function<void(const TcpConnectionPtr &, size_t)>;
 using MessageCallback = std::function<void (const TcpConnectionPtr&, Buffer*, Timestamp)>;
-using TimerCallback = std::function<void()> ;
+using TimerCallback = SmallTask;
 
 using EventCallback = std::function<void()>;
 using ReadEventCallback = std::function<void(Timestamp)>;
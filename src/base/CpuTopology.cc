@@ -0,0 +1,111 @@
+#include "base/CpuTopology.h"
+
+#include <algorithm>
+#include <map>
+#include <tuple>
+#include <utility>
+#include <dirent.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace
+{
+/// @brief 读取sysfs中只包含一个整数的文件，失败时返回defaultValue
+int readIntFile(const char* path, int defaultValue)
+{
+    FILE* fp = ::fopen(path, "r");
+    if(fp == nullptr)
+    {
+        return defaultValue;
+    }
+    int value = defaultValue;
+    if(::fscanf(fp, "%d", &value) != 1)
+    {
+        value = defaultValue;
+    }
+    ::fclose(fp);
+    return value;
+}
+}
+
+std::vector<int> CpuTopology::allowedCpus()
+{
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if(::sched_getaffinity(0, sizeof set, &set) == 0)
+    {
+        for(int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        {
+            if(CPU_ISSET(cpu, &set))
+            {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+    return cpus;
+}
+
+int CpuTopology::nodeOfCpu(int cpu)
+{
+    // 属于节点N的CPU目录下有一个名为nodeN的链接
+    char path[64];
+    snprintf(path, sizeof path, "/sys/devices/system/cpu/cpu%d", cpu);
+    DIR* dir = ::opendir(path);
+    if(dir == nullptr)
+    {
+        return 0;
+    }
+    int node = 0;
+    while(dirent* entry = ::readdir(dir))
+    {
+        if(::strncmp(entry->d_name, "node", 4) == 0 &&
+           entry->d_name[4] >= '0' && entry->d_name[4] <= '9')
+        {
+            node = ::atoi(entry->d_name + 4);
+            break;
+        }
+    }
+    ::closedir(dir);
+    return node;
+}
+
+std::vector<int> CpuTopology::spreadOrder()
+{
+    // 排序键：(同一物理核心上的序号, 在所属节点中的序号, 节点, cpu)
+    using Key = std::tuple<int, int, int, int>;
+    std::vector<Key> keys;
+    std::map<std::pair<int, int>, int> threadsOfCore;  /* (package, core) -> 已出现的超线程数 */
+    std::map<std::pair<int, int>, int> cpusOfNode;      /* (超线程序号, node) -> 已出现的CPU数 */
+    char path[96];
+    for(int cpu: allowedCpus())
+    {
+        snprintf(path, sizeof path, "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+        int package = readIntFile(path, 0);
+        snprintf(path, sizeof path, "/sys/devices/system/cpu/cpu%d/topology/core_id", cpu);
+        int core = readIntFile(path, cpu);
+        int node = nodeOfCpu(cpu);
+        int smt = threadsOfCore[std::make_pair(package, core)]++;
+        int rank = cpusOfNode[std::make_pair(smt, node)]++;
+        keys.emplace_back(smt, rank, node, cpu);
+    }
+    std::sort(keys.begin(), keys.end());
+
+    std::vector<int> order;
+    order.reserve(keys.size());
+    for(const Key& key: keys)
+    {
+        order.push_back(std::get<3>(key));
+    }
+    return order;
+}
+
+bool CpuTopology::pinCurrentThread(int cpu)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return ::sched_setaffinity(0, sizeof set, &set) == 0;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <vector>
+
+/// @brief 读取/sys与sched_getaffinity得到的CPU拓扑信息，用于绑定循环线程
+namespace CpuTopology
+{
+    /// @brief 当前进程允许运行的CPU编号（升序）
+    std::vector<int> allowedCpus();
+
+    /// @brief CPU所在的NUMA节点，无法确定时返回0
+    int nodeOfCpu(int cpu);
+
+    /// @brief 自动绑定时使用的CPU顺序：先占满不同的物理核心，再使用超线程；
+    /// 相邻的CPU交替来自不同的NUMA节点，使循环线程均匀分布在各个节点上
+    std::vector<int> spreadOrder();
+
+    /// @brief 将调用线程绑定到指定CPU
+    /// @return 是否成功
+    bool pinCurrentThread(int cpu);
+}
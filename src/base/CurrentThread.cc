@@ -4,6 +4,7 @@
 #include <cxxabi.h>
 #include <execinfo.h>
 #include <stdlib.h>
+#include <time.h>
 
 __thread int CurrentThread::t_cachedTid = 0;
 __thread const char* CurrentThread::t_threadName = nullptr;
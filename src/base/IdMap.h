@@ -0,0 +1,158 @@
+#pragma once
+
+#include "base/noncopyable.h"
+
+#include <utility>
+#include <vector>
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/// @brief 以非0的64位整数为键的开放寻址哈希表（线性探测），用于按id保存连接等对象。
+/// 所有元素保存在一个连续的数组中，查找、插入与删除都不分配内存（扩容除外），
+/// 比较的是整数而不是字符串。键0表示空槽，不能作为键使用。
+/// 删除时把后面同一探测序列上的元素向前移动（backward shift），不留下墓碑，
+/// 反复插入删除也不会使探测序列变长。负载因子不超过1/2
+template<typename V>
+class IdMap: noncopyable
+{
+public:
+    explicit IdMap(size_t initialCapacity = 16):
+        size_(0)
+    {
+        size_t capacity = 16;
+        while(capacity < initialCapacity * 2)
+        {
+            capacity <<= 1;
+        }
+        slots_.resize(capacity);
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_t capacity() const { return slots_.size(); }
+
+    /// @brief 插入或替换id对应的值
+    void insert(uint64_t id, V value)
+    {
+        assert(id != 0);
+        if((size_ + 1) * 2 > slots_.size())
+        {
+            rehash(slots_.size() * 2);
+        }
+        size_t i = probe(id);
+        if(slots_[i].first == 0)
+        {
+            slots_[i].first = id;
+            ++size_;
+        }
+        slots_[i].second = std::move(value);
+    }
+
+    /// @return id对应的值，不存在时返回nullptr
+    V* find(uint64_t id)
+    {
+        size_t i = probe(id);
+        return slots_[i].first == id ? &slots_[i].second : nullptr;
+    }
+    const V* find(uint64_t id) const
+    {
+        return const_cast<IdMap*>(this)->find(id);
+    }
+
+    /// @return 是否删除了元素
+    bool erase(uint64_t id)
+    {
+        size_t mask = slots_.size() - 1;
+        size_t i = probe(id);
+        if(slots_[i].first != id)
+        {
+            return false;
+        }
+        // 把后面的元素前移到空出的位置，直到遇到空槽或已经在自己位置上的元素
+        size_t j = i;
+        while(true)
+        {
+            j = (j + 1) & mask;
+            if(slots_[j].first == 0)
+            {
+                break;
+            }
+            size_t home = hash(slots_[j].first);
+            // home不在(i, j]之间时，j上的元素可以移到i
+            if(((j - home) & mask) >= ((j - i) & mask))
+            {
+                slots_[i] = std::move(slots_[j]);
+                i = j;
+            }
+        }
+        slots_[i].first = 0;
+        slots_[i].second = V();
+        --size_;
+        return true;
+    }
+
+    void clear()
+    {
+        for(auto& slot: slots_)
+        {
+            slot.first = 0;
+            slot.second = V();
+        }
+        size_ = 0;
+    }
+
+    /// @brief 按槽的顺序遍历所有元素，func(id, value)中不能插入或删除
+    template<typename Func>
+    void forEach(Func func)
+    {
+        for(auto& slot: slots_)
+        {
+            if(slot.first != 0)
+            {
+                func(slot.first, slot.second);
+            }
+        }
+    }
+
+private:
+    /// 斐波那契散列：连续的id被分散到整个数组
+    size_t hash(uint64_t id) const
+    {
+        return static_cast<size_t>((id * 0x9E3779B97F4A7C15ULL) >> shift()) & (slots_.size() - 1);
+    }
+
+    int shift() const
+    {
+        return 64 - __builtin_ctzll(slots_.size());
+    }
+
+    /// @return id所在的槽，不存在时返回探测序列上的第一个空槽
+    size_t probe(uint64_t id) const
+    {
+        size_t mask = slots_.size() - 1;
+        size_t i = hash(id);
+        while(slots_[i].first != 0 && slots_[i].first != id)
+        {
+            i = (i + 1) & mask;
+        }
+        return i;
+    }
+
+    void rehash(size_t capacity)
+    {
+        std::vector<std::pair<uint64_t, V>> old(capacity);
+        old.swap(slots_);
+        size_ = 0;
+        for(auto& slot: old)
+        {
+            if(slot.first != 0)
+            {
+                insert(slot.first, std::move(slot.second));
+            }
+        }
+    }
+
+    std::vector<std::pair<uint64_t, V>> slots_;
+    size_t size_;
+};
@@ -0,0 +1,153 @@
+#pragma once
+
+#include "base/noncopyable.h"
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+/// @brief 无锁的多生产者单消费者队列（Dmitry Vyukov的链表实现）。
+/// push可以由任意线程调用，只需一次原子交换；empty/consume只能由唯一的消费者线程调用。
+/// 队列始终保留一个哑节点，tail_指向它，其后的节点才是有效元素。
+/// 消费者释放的节点会成批交还给生产者复用（见allocNode/recycleNode），稳定运行时入队不需要分配内存。
+template<typename T>
+class MpscQueue: noncopyable
+{
+public:
+    MpscQueue():
+        head_(new Node),
+        freeBatch_(nullptr),
+        tail_(head_.load(std::memory_order_relaxed)),
+        freeList_(nullptr),
+        freeCount_(0)
+    {
+    }
+
+    ~MpscQueue()
+    {
+        deleteList(tail_);
+        deleteList(freeList_);
+        deleteList(freeBatch_.load(std::memory_order_relaxed));
+    }
+
+    /// @brief 入队，线程安全
+    void push(T value)
+    {
+        Node* node = allocNode();
+        node->value = std::move(value);
+        Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+        // 在这里到next被设置之前，消费者会认为队列在prev处结束
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    /// @brief 队列是否为空。生产者正在入队的元素可能暂时不可见
+    bool empty() const
+    {
+        return tail_->next.load(std::memory_order_acquire) == nullptr;
+    }
+
+    /// @brief 依次取出并处理调用时已在队列中的元素，处理期间新入队的元素留到下一次调用。
+    /// @return 处理的元素个数
+    template<typename Func>
+    size_t consume(Func func)
+    {
+        Node* last = head_.load(std::memory_order_acquire);
+        size_t n = 0;
+        while(tail_ != last)
+        {
+            Node* next = tail_->next.load(std::memory_order_acquire);
+            if(next == nullptr)
+            {
+                break;
+            }
+            recycleNode(tail_);
+            tail_ = next;
+            // 取出后next成为新的哑节点
+            T value(std::move(next->value));
+            func(value);
+            ++n;
+        }
+        // 上一批空闲节点已被生产者取走时，交出新的一批
+        if(freeList_ && freeBatch_.load(std::memory_order_relaxed) == nullptr)
+        {
+            freeBatch_.store(freeList_, std::memory_order_release);
+            freeList_ = nullptr;
+            freeCount_ = 0;
+        }
+        return n;
+    }
+
+private:
+    struct Node
+    {
+        Node(): next(nullptr), value() {}
+        explicit Node(T&& v): next(nullptr), value(std::move(v)) {}
+
+        std::atomic<Node*> next;
+        T value;
+    };
+
+    static const size_t kMaxFreeNodes = 1024;
+
+    /// @brief 生产者线程的空闲节点缓存，同类型的队列共用
+    struct NodeCache
+    {
+        NodeCache(): head(nullptr) {}
+        ~NodeCache() { deleteList(head); }
+        Node* head;
+    };
+
+    static NodeCache& localCache()
+    {
+        static thread_local NodeCache cache;
+        return cache;
+    }
+
+    static void deleteList(Node* node)
+    {
+        while(node)
+        {
+            Node* next = node->next.load(std::memory_order_relaxed);
+            delete node;
+            node = next;
+        }
+    }
+
+    /// @brief 优先从本线程缓存中获取节点，缓存为空时取走消费者交出的整批空闲节点
+    Node* allocNode()
+    {
+        NodeCache& cache = localCache();
+        if(cache.head == nullptr && freeBatch_.load(std::memory_order_relaxed) != nullptr)
+        {
+            cache.head = freeBatch_.exchange(nullptr, std::memory_order_acquire);
+        }
+        Node* node = cache.head;
+        if(node == nullptr)
+        {
+            return new Node;
+        }
+        cache.head = node->next.load(std::memory_order_relaxed);
+        node->next.store(nullptr, std::memory_order_relaxed);
+        return node;
+    }
+
+    /// @brief 消费者回收节点，超过上限的直接释放
+    void recycleNode(Node* node)
+    {
+        if(freeCount_ >= kMaxFreeNodes)
+        {
+            delete node;
+            return;
+        }
+        node->next.store(freeList_, std::memory_order_relaxed);
+        freeList_ = node;
+        ++freeCount_;
+    }
+
+    // 生产者与消费者分别修改的字段放在不同的缓存行，避免伪共享
+    alignas(64) std::atomic<Node*> head_;   /* 最后入队的节点，由生产者修改 */
+    std::atomic<Node*> freeBatch_;          /* 消费者交给生产者的一批空闲节点，只有为空时才会被消费者写入 */
+    alignas(64) Node* tail_;                /* 哑节点，只由消费者访问 */
+    Node* freeList_;                        /* 消费者回收的空闲节点 */
+    size_t freeCount_;
+};
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/// @brief 只能移动的void()可调用对象，替代std::function<void()>用于投递任务。
+/// 不超过kInlineSize字节的可调用对象（如绑定了this和shared_ptr的std::bind）直接保存在对象内部，
+/// 构造与移动都不需要分配内存；更大的对象才会保存在堆上。
+/// @note std::bind的移动构造没有声明noexcept，因此这里不要求可调用对象nothrow移动，
+/// 内部保存的对象在移动时抛出异常会导致std::terminate。
+class SmallTask
+{
+public:
+    static const size_t kInlineSize = 56;
+
+    SmallTask() noexcept: ops_(nullptr) {}
+    SmallTask(std::nullptr_t) noexcept: ops_(nullptr) {}
+
+    template<typename F,
+             typename = typename std::enable_if<
+                 !std::is_same<typename std::decay<F>::type, SmallTask>::value>::type>
+    SmallTask(F&& f):
+        ops_(nullptr)
+    {
+        using Func = typename std::decay<F>::type;
+        const Func& decayed = f;
+        if(isNull(decayed))
+        {
+            return;
+        }
+        if(fitsInline<Func>())
+        {
+            new (storage_) Func(std::forward<F>(f));
+            ops_ = &InlineOps<Func>::ops;
+        }
+        else
+        {
+            *reinterpret_cast<Func**>(storage_) = new Func(std::forward<F>(f));
+            ops_ = &HeapOps<Func>::ops;
+        }
+    }
+
+    SmallTask(SmallTask&& rhs) noexcept:
+        ops_(rhs.ops_)
+    {
+        if(ops_)
+        {
+            ops_->move(storage_, rhs.storage_);
+            rhs.ops_ = nullptr;
+        }
+    }
+
+    SmallTask& operator=(SmallTask&& rhs) noexcept
+    {
+        if(this != &rhs)
+        {
+            reset();
+            if(rhs.ops_)
+            {
+                rhs.ops_->move(storage_, rhs.storage_);
+                ops_ = rhs.ops_;
+                rhs.ops_ = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    SmallTask& operator=(std::nullptr_t) noexcept
+    {
+        reset();
+        return *this;
+    }
+
+    SmallTask(const SmallTask&) = delete;
+    SmallTask& operator=(const SmallTask&) = delete;
+
+    ~SmallTask() { reset(); }
+
+    void operator()() const { ops_->invoke(const_cast<unsigned char*>(storage_)); }
+
+    explicit operator bool() const { return ops_ != nullptr; }
+
+    /// @brief 可调用对象是否保存在对象内部（用于测试）
+    template<typename F>
+    static constexpr bool fitsInline()
+    {
+        return sizeof(F) <= kInlineSize &&
+               alignof(F) <= alignof(std::max_align_t) &&
+               std::is_move_constructible<F>::value;
+    }
+
+private:
+    struct Ops
+    {
+        void (*invoke)(void* storage);
+        /// 移动构造到dst并析构src
+        void (*move)(void* dst, void* src);
+        void (*destroy)(void* storage);
+    };
+
+    template<typename Func>
+    struct InlineOps
+    {
+        static void invoke(void* s) { (*static_cast<Func*>(s))(); }
+        static void move(void* dst, void* src)
+        {
+            Func* f = static_cast<Func*>(src);
+            new (dst) Func(std::move(*f));
+            f->~Func();
+        }
+        static void destroy(void* s) { static_cast<Func*>(s)->~Func(); }
+        static const Ops ops;
+    };
+
+    template<typename Func>
+    struct HeapOps
+    {
+        static Func*& get(void* s) { return *static_cast<Func**>(s); }
+        static void invoke(void* s) { (*get(s))(); }
+        static void move(void* dst, void* src) { *static_cast<Func**>(dst) = get(src); }
+        static void destroy(void* s) { delete get(s); }
+        static const Ops ops;
+    };
+
+    template<typename F>
+    static bool isNull(const F&) { return false; }
+    template<typename R>
+    static bool isNull(R (*f)()) { return f == nullptr; }
+    template<typename Sig>
+    static bool isNull(const std::function<Sig>& f) { return !f; }
+
+    void reset() noexcept
+    {
+        if(ops_)
+        {
+            ops_->destroy(storage_);
+            ops_ = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char storage_[kInlineSize];
+    const Ops* ops_;
+};
+
+template<typename Func>
+const SmallTask::Ops SmallTask::InlineOps<Func>::ops =
+{
+    &SmallTask::InlineOps<Func>::invoke,
+    &SmallTask::InlineOps<Func>::move,
+    &SmallTask::InlineOps<Func>::destroy
+};
+
+template<typename Func>
+const SmallTask::Ops SmallTask::HeapOps<Func>::ops =
+{
+    &SmallTask::HeapOps<Func>::invoke,
+    &SmallTask::HeapOps<Func>::move,
+    &SmallTask::HeapOps<Func>::destroy
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <stddef.h>
+#include <string.h>
+
+/// @brief 指向一段不属于自己的字节的只读视图（C++17 std::string_view的简化版本），复制与传递都不分配内存。
+/// 视图不延长数据的生命周期：指向Buffer时，只在下一次修改Buffer之前有效
+class StringPiece
+{
+public:
+    StringPiece(): data_(nullptr), size_(0) {}
+    StringPiece(const char* data, size_t size): data_(data), size_(size) {}
+    StringPiece(const char* str): data_(str), size_(::strlen(str)) {}
+    StringPiece(const std::string& str): data_(str.data()), size_(str.size()) {}
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const char* begin() const { return data_; }
+    const char* end() const { return data_ + size_; }
+    char operator[](size_t i) const { return data_[i]; }
+
+    void removePrefix(size_t n) { data_ += n; size_ -= n; }
+    void removeSuffix(size_t n) { size_ -= n; }
+    StringPiece substr(size_t pos, size_t n) const
+    {
+        return StringPiece(data_ + pos, n < size_ - pos ? n : size_ - pos);
+    }
+
+    bool startsWith(const StringPiece& x) const
+    {
+        return size_ >= x.size_ && ::memcmp(data_, x.data_, x.size_) == 0;
+    }
+
+    bool operator==(const StringPiece& x) const
+    {
+        return size_ == x.size_ && ::memcmp(data_, x.data_, size_) == 0;
+    }
+    bool operator!=(const StringPiece& x) const { return !(*this == x); }
+
+    std::string toString() const { return std::string(data_, size_); }
+
+private:
+    const char* data_;
+    size_t size_;
+};
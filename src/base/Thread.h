@@ -2,6 +2,8 @@
 
 #include "base/noncopyable.h"
 #include <thread>
+#include <string>
+#include <memory>
 #include <functional>
 #include <atomic>
 
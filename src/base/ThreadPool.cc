@@ -29,8 +29,7 @@ void ThreadPool::start(int numThreads)
     {
         std::string name = name_ + std::to_string(i+1);
         // 生成runInThread的函数对象（类成员函数需要绑定类实例指针）
-        Task task = std::bind(&ThreadPool::runInThread, this);
-        threads_.emplace_back(new Thread(task, name));
+        threads_.emplace_back(new Thread(std::bind(&ThreadPool::runInThread, this), name));
         threads_[i]->start();
     }
 
@@ -94,7 +93,7 @@ void ThreadPool::runInThread()
                 notEmpty_.wait(lock, [this](){return !running_ || !queue_.empty();});
                 if(!queue_.empty() && running_)
                 {
-                    task = queue_.front();
+                    task = std::move(queue_.front());
                     queue_.pop_front();
                     if(maxQueueSize_ > 0)
                     {
@@ -2,6 +2,7 @@
 
 #include "base/noncopyable.h"
 #include "base/Thread.h"
+#include "base/SmallTask.h"
 
 #include <vector>
 #include <deque>
@@ -11,14 +12,15 @@
 class ThreadPool: noncopyable
 {
 public:
-    using Task = std::function<void()>; 
+    using Task = SmallTask;
+    using ThreadInitCallback = std::function<void()>;
 
     explicit ThreadPool(const std::string& name = std::string("ThreadPool"));
     ~ThreadPool();
 
     // 需要在start之前配置
     void setMaxQueueSize(int maxSize) {maxQueueSize_ = maxSize; }
-    void setThreadInitCallback(const Task& task) { threadInitCallback_ = task; }
+    void setThreadInitCallback(const ThreadInitCallback& cb) { threadInitCallback_ = cb; }
 
     
     /// @brief 初始化线程，线程函数为runInThread
@@ -42,7 +44,7 @@ private:
     mutable std::mutex mutex_;  /* task队列互斥量 */
     std::condition_variable notEmpty_, notFull_;    /* 判断队列是否空/满 */
     std::string name_;
-    Task threadInitCallback_;
+    ThreadInitCallback threadInitCallback_;
     std::vector<std::unique_ptr<Thread>> threads_;
     std::deque<Task> queue_;
     size_t maxQueueSize_;
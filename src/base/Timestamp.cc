@@ -1,6 +1,7 @@
 #include "Timestamp.h"
 
 #include <inttypes.h> 
+#include <time.h>
 
 Timestamp Timestamp::now()
 {
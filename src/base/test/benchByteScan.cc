@@ -0,0 +1,76 @@
+#include "base/ByteScan.h"
+#include "base/Timestamp.h"
+
+#include <algorithm>
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// 在没有分隔符的数据中查找分隔符的吞吐量(GB/s)，对比各个实现以及原来的std::search与memchr。
+/// 每次查找lineLength字节，模拟文本协议中按行查找分隔符。
+/// 用法: benchByteScan [lineLength=1024]
+
+namespace
+{
+const size_t kTotalBytes = 1UL << 30;
+
+template<typename Find>
+double measure(size_t lineLength, Find find)
+{
+    std::string data(lineLength + 1, 'x');
+    data[lineLength] = '\n';
+    data[lineLength - 1] = '\r';
+    size_t iterations = kTotalBytes / lineLength;
+    size_t found = 0;
+    Timestamp start = Timestamp::now();
+    for(size_t i = 0; i < iterations; i++)
+    {
+        const char* p = find(data.data(), data.data() + data.size());
+        found += p != nullptr;
+        // 防止编译器把循环外提
+        __asm__ volatile("" : : "r"(data.data()) : "memory");
+    }
+    double seconds = timeDifference(Timestamp::now(), start);
+    if(found != iterations)
+    {
+        fprintf(stderr, "unexpected result\n");
+    }
+    return static_cast<double>(iterations) * lineLength / seconds / (1 << 30);
+}
+}
+
+int main(int argc, char* argv[])
+{
+    size_t lineLength = argc > 1 ? static_cast<size_t>(atoi(argv[1])) : 1024;
+    if(lineLength < 2)
+    {
+        lineLength = 2;
+    }
+    printf("line length %zu, GB/s\n", lineLength);
+    printf("%-8s %8s %8s %8s\n", "", "CRLF", "byte", "any(4)");
+    printf("%-8s %8.2f %8.2f\n", "baseline",
+           measure(lineLength, [](const char* b, const char* e)
+           {
+               const char crlf[] = "\r\n";
+               const char* p = std::search(b, e, crlf, crlf + 2);
+               return p == e ? nullptr : p;
+           }),
+           measure(lineLength, [](const char* b, const char* e)
+           {
+               return static_cast<const char*>(memchr(b, '\n', e - b));
+           }));
+    ByteScan::Isa isas[] = { ByteScan::kScalar, ByteScan::kSse2, ByteScan::kAvx2 };
+    for(ByteScan::Isa isa: isas)
+    {
+        if(!ByteScan::setIsa(isa))
+        {
+            continue;
+        }
+        printf("%-8s %8.2f %8.2f %8.2f\n", ByteScan::isaName(isa),
+               measure(lineLength, [](const char* b, const char* e) { return ByteScan::findCRLF(b, e); }),
+               measure(lineLength, [](const char* b, const char* e) { return ByteScan::findByte(b, e, '\n'); }),
+               measure(lineLength, [](const char* b, const char* e) { return ByteScan::findAny(b, e, " :\t\n", 4); }));
+    }
+    return 0;
+}
@@ -0,0 +1,65 @@
+#include "base/IdMap.h"
+#include "base/Timestamp.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdio.h>
+
+/// 连接表的开销：保持kLive个连接，每次新建一个连接并移除最早的一个。
+/// string map: 原来的做法，拼接名称后以std::map<std::string, ...>保存
+/// IdMap:      以64位id为键的开放寻址哈希表，不构造名称
+
+namespace
+{
+const int kLive = 10000;
+const int kOps = 1000000;
+const std::string kPrefix("EchoServer0.0.0.0:2007");
+
+template<typename Func>
+void measure(const char* name, Func func)
+{
+    Timestamp start = Timestamp::now();
+    size_t checksum = func();
+    double seconds = timeDifference(Timestamp::now(), start);
+    printf("%-12s %6.1f ns/connection  (checksum %zu)\n", name, seconds * 1e9 / kOps, checksum);
+}
+}
+
+int main()
+{
+    std::shared_ptr<int> value(std::make_shared<int>(0));
+    measure("string map", [&value]()
+    {
+        std::map<std::string, std::shared_ptr<int>> map;
+        std::vector<std::string> names;
+        names.reserve(kOps + kLive);
+        size_t checksum = 0;
+        for(int i = 1; i <= kOps + kLive; i++)
+        {
+            names.push_back(kPrefix + std::to_string(i));
+            map[names.back()] = value;
+            if(i > kLive)
+            {
+                checksum += map.erase(names[i - kLive - 1]);
+            }
+        }
+        return checksum + map.size();
+    });
+    measure("IdMap", [&value]()
+    {
+        IdMap<std::shared_ptr<int>> map;
+        size_t checksum = 0;
+        for(uint64_t id = 1; id <= static_cast<uint64_t>(kOps + kLive); id++)
+        {
+            map.insert(id, value);
+            if(id > static_cast<uint64_t>(kLive))
+            {
+                checksum += map.erase(id - kLive);
+            }
+        }
+        return checksum + map.size();
+    });
+    return 0;
+}
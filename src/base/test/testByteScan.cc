@@ -0,0 +1,88 @@
+#include "base/ByteScan.h"
+
+#include <algorithm>
+#include <string>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// 各个实现的查找结果与朴素实现一致：随机位置的分隔符、不同的起止偏移（覆盖向量的尾部处理）
+
+namespace
+{
+const char* naiveFindAny(const char* begin, const char* end, const char* set, size_t setLen)
+{
+    for(const char* p = begin; p < end; ++p)
+    {
+        if(memchr(set, *p, setLen) != nullptr)
+        {
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+const char* naiveFindCRLF(const char* begin, const char* end)
+{
+    const char crlf[] = "\r\n";
+    const char* p = std::search(begin, end, crlf, crlf + 2);
+    return p == end ? nullptr : p;
+}
+
+void check(ByteScan::Isa isa)
+{
+    if(!ByteScan::setIsa(isa))
+    {
+        printf("%s not supported, skipped\n", ByteScan::isaName(isa));
+        return;
+    }
+    assert(ByteScan::isa() == isa);
+    const char anySet[] = " :\r\n";
+    const std::string bigSet("abcdefghijklmnopqrstuvwxyz");
+    srand(isa + 1);
+    for(int round = 0; round < 2000; round++)
+    {
+        // 大部分是不会命中的字节，少量分隔符随机分布，'\r'与'\n'也会单独出现
+        std::string data(rand() % 300, 'x');
+        int numHits = rand() % 4;
+        for(int i = 0; i < numHits && !data.empty(); i++)
+        {
+            const char candidates[] = "\r\n:a ";
+            data[rand() % data.size()] = candidates[rand() % 5];
+        }
+        for(size_t offset = 0; offset <= std::min<size_t>(data.size(), 40); offset += 7)
+        {
+            const char* begin = data.data() + offset;
+            const char* end = data.data() + data.size();
+            assert(ByteScan::findByte(begin, end, '\n') == naiveFindAny(begin, end, "\n", 1));
+            assert(ByteScan::findByte(begin, end, ':') == naiveFindAny(begin, end, ":", 1));
+            assert(ByteScan::findCRLF(begin, end) == naiveFindCRLF(begin, end));
+            assert(ByteScan::findAny(begin, end, anySet, 4) == naiveFindAny(begin, end, anySet, 4));
+            assert(ByteScan::findAny(begin, end, bigSet.data(), bigSet.size()) ==
+                   naiveFindAny(begin, end, bigSet.data(), bigSet.size()));
+            assert(ByteScan::findAny(begin, end, anySet, 0) == nullptr);
+        }
+    }
+    // 横跨向量边界的"\r\n"
+    for(size_t pos = 0; pos < 70; pos++)
+    {
+        std::string data(72, 'x');
+        data[pos] = '\r';
+        data[pos + 1] = '\n';
+        assert(ByteScan::findCRLF(data.data(), data.data() + data.size()) == data.data() + pos);
+        // 末尾单独的'\r'不算
+        assert(ByteScan::findCRLF(data.data(), data.data() + pos + 1) == nullptr);
+    }
+    printf("%s passed\n", ByteScan::isaName(isa));
+}
+}
+
+int main()
+{
+    printf("default: %s\n", ByteScan::isaName(ByteScan::isa()));
+    check(ByteScan::kScalar);
+    check(ByteScan::kSse2);
+    check(ByteScan::kAvx2);
+    return 0;
+}
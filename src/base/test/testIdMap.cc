@@ -0,0 +1,87 @@
+#include "base/IdMap.h"
+
+#include <memory>
+#include <random>
+#include <unordered_map>
+#include <assert.h>
+#include <stdio.h>
+
+/// IdMap的插入、查找、删除与扩容，与std::unordered_map对照
+
+void testBasic()
+{
+    IdMap<std::shared_ptr<int>> map;
+    assert(map.empty());
+    for(uint64_t id = 1; id <= 100; id++)
+    {
+        map.insert(id, std::make_shared<int>(static_cast<int>(id)));
+    }
+    assert(map.size() == 100);
+    assert(map.capacity() >= 200);
+    assert(**map.find(42) == 42);
+    assert(map.find(101) == nullptr);
+
+    // 删除后值被释放，其他元素仍然可以找到
+    std::shared_ptr<int> held = *map.find(7);
+    assert(held.use_count() == 2);
+    assert(map.erase(7));
+    assert(!map.erase(7));
+    assert(held.use_count() == 1);
+    for(uint64_t id = 1; id <= 100; id++)
+    {
+        assert((map.find(id) != nullptr) == (id != 7));
+    }
+
+    map.insert(42, std::make_shared<int>(-1));
+    assert(map.size() == 99);
+    assert(**map.find(42) == -1);
+
+    size_t visited = 0;
+    map.forEach([&visited](uint64_t id, std::shared_ptr<int>& value)
+    {
+        assert(id != 7);
+        assert(value);
+        ++visited;
+    });
+    assert(visited == 99);
+    map.clear();
+    assert(map.empty() && map.find(1) == nullptr);
+    printf("testBasic passed\n");
+}
+
+void testRandom()
+{
+    std::mt19937_64 rng(12345);
+    IdMap<uint64_t> map;
+    std::unordered_map<uint64_t, uint64_t> expected;
+    // 小的键空间使插入与删除在同一批槽上反复发生，覆盖删除时的元素前移
+    for(int i = 0; i < 200000; i++)
+    {
+        uint64_t id = rng() % 4096 + 1;
+        if(rng() % 3 == 0)
+        {
+            assert(map.erase(id) == (expected.erase(id) == 1));
+        }
+        else
+        {
+            map.insert(id, i);
+            expected[id] = i;
+        }
+        assert(map.size() == expected.size());
+    }
+    for(uint64_t id = 1; id <= 4096; id++)
+    {
+        auto it = expected.find(id);
+        const uint64_t* value = map.find(id);
+        assert((value != nullptr) == (it != expected.end()));
+        assert(value == nullptr || *value == it->second);
+    }
+    printf("testRandom passed\n");
+}
+
+int main()
+{
+    testBasic();
+    testRandom();
+    return 0;
+}
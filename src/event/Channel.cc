@@ -2,7 +2,7 @@
 #include "event/Channel.h"
 #include "event/EventLoop.h"
 
-#include <sstream>
+#include <string>
 #include <assert.h>
 #include <poll.h>
 
@@ -13,6 +13,7 @@ Channel::Channel(EventLoop *eventLoop, int fd):
     revents_(0),
     index_(-1),
     tied_(false),
+    edgeTriggered_(false),
     eventHandling_(false),
     addedToLoop_(false)
 {
@@ -51,6 +52,15 @@ void Channel::tie(const std::shared_ptr<void> &ptr)
     tied_ = true;
 }
 
+void Channel::setEdgeTriggered(bool on)
+{
+    edgeTriggered_ = on;
+    if(addedToLoop_ && !isNoneEvent())
+    {
+        update();
+    }
+}
+
 void Channel::remove()
 {
     assert(isNoneEvent());
@@ -58,26 +68,26 @@ void Channel::remove()
     loop_->removeChannel(this);
 }
 
-std::string Channel::eventToString()
+std::string Channel::eventsToString(int fd, int ev)
 {
-    std::ostringstream oss;
-    oss << fd_ << ": ";
-    if (events_ & POLLIN)
-    oss << "IN ";
-    if (events_ & POLLPRI)
-    oss << "PRI ";
-    if (events_ & POLLOUT)
-    oss << "OUT ";
-    if (events_ & POLLHUP)
-    oss << "HUP ";
-    if (events_ & POLLRDHUP)
-    oss << "RDHUP ";
-    if (events_ & POLLERR)
-    oss << "ERR ";
-    if (events_ & POLLNVAL)
-    oss << "NVAL ";
+    std::string str = std::to_string(fd);
+    str += ": ";
+    if (ev & POLLIN)
+    str += "IN ";
+    if (ev & POLLPRI)
+    str += "PRI ";
+    if (ev & POLLOUT)
+    str += "OUT ";
+    if (ev & POLLHUP)
+    str += "HUP ";
+    if (ev & POLLRDHUP)
+    str += "RDHUP ";
+    if (ev & POLLERR)
+    str += "ERR ";
+    if (ev & POLLNVAL)
+    str += "NVAL ";
 
-    return oss.str();
+    return str;
 }
 void Channel::update()
 {
@@ -94,7 +104,7 @@ void Channel::handleEventWithGuard(Timestamp receiveTime)
         错误：POLLERR POLLHUP POLLNVAL
     */
     eventHandling_ = true;
-    LOG_WARN << eventToString();
+    LOG_TRACE << reventsToString();
     if ((revents_ & POLLHUP) && !(revents_ & POLLIN))
     {
         LOG_WARN << "fd = " << fd_ << " Channel::handle_event() POLLHUP";
@@ -108,7 +118,8 @@ void Channel::handleEventWithGuard(Timestamp receiveTime)
 
     if (revents_ & (POLLERR | POLLNVAL))
     {
-        if (errorCallback_) errorCallback_();
+        if ((revents_ & POLLERR) && errorQueueCallback_) errorQueueCallback_();
+        else if (errorCallback_) errorCallback_();
     }
     if (revents_ & (POLLIN | POLLPRI | POLLRDHUP))
     {
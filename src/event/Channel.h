@@ -20,6 +20,9 @@ public:
     void setWriteCallback(EventCallback cb) { writeCallback_ = std::move(cb); }
     void setCloseCallback(EventCallback cb) { closeCallback_ = std::move(cb); }
     void setErrorCallback(EventCallback cb) { errorCallback_ = std::move(cb); }
+    /// @brief 设置后POLLERR改为交给该回调处理，用于读取socket错误队列中的消息（如MSG_ZEROCOPY的完成通知）。
+    /// 回调需要自行判断是否发生了真正的错误
+    void setErrorQueueCallback(EventCallback cb) { errorQueueCallback_ = std::move(cb); }
 
 
     /// @brief 获取某个依赖对象的weak指针，并在需要时编程shared以防止期间对象被意外的remove
@@ -36,6 +39,10 @@ public:
     void enableWriting() { events_ |= kWriteEvent; update(); }
     void disableWriting() { events_ &= ~kWriteEvent; update(); }
     void disableAll() { events_ = kNoneEvent; update(); }
+
+    /// @brief 设置边缘触发模式(EPOLLET)。该模式下回调函数需要读写直到EAGAIN，否则不会再次收到通知
+    void setEdgeTriggered(bool on);
+    bool isEdgeTriggered() const { return edgeTriggered_; }
     
     // fd状态
 
@@ -58,8 +65,12 @@ public:
     void remove();
 
     // for debug
-    std::string eventToString();
+    /// @brief 感兴趣的事件
+    std::string eventToString() const { return eventsToString(fd_, events_); }
+    /// @brief 本次接收到的事件
+    std::string reventsToString() const { return eventsToString(fd_, revents_); }
 private:
+    static std::string eventsToString(int fd, int ev);
 
     /// @brief 在poller中更新感兴趣的事件。
     /// 该函数在设置感兴趣事件后被调用，第一次调用会假设该channel已被添加进loop
@@ -84,6 +95,7 @@ private:
 
     std::weak_ptr<void> tie_; /* 指向依赖对象（TcpConnection）的指针，必要时转化成共享指针 */
     bool tied_;
+    bool edgeTriggered_;
     bool eventHandling_;
     bool addedToLoop_;
 
@@ -93,4 +105,5 @@ private:
     EventCallback writeCallback_;
     EventCallback closeCallback_;
     EventCallback errorCallback_;
+    EventCallback errorQueueCallback_;
 };
@@ -3,7 +3,6 @@
 #include "logger/Logging.h"
 #include "base/CurrentThread.h"
 
-#include <mutex>
 #include <vector>
 #include <assert.h>
 #include <sys/eventfd.h>
@@ -42,7 +41,13 @@ EventLoop::EventLoop():
     quit_(false),
     eventHandling_(false),
     callingPendingFunctors_(false),
+    polling_(false),
     iteration_(0),
+    busyPollUs_(0),
+    socketBusyPollUs_(0),
+    lastActiveUs_(0),
+    spinPolls_(0),
+    blockingPolls_(0),
     threadId_(CurrentThread::tid()),
     pollReturnTime_(),
     wakeupFd_(Utils::createEventfd()),
@@ -88,8 +93,39 @@ void EventLoop::loop()
     while(!quit_.load())
     {
         activeChannels_.clear();
-        pollReturnTime_ = poller_->poll(Utils::kPollTimeMs, &activeChannels_);
+        // 编译时关闭统计时measure恒为false，计时代码会被优化掉
+        const bool measure = stats_.enabled();
+        int64_t pollStart = measure ? LoopStats::nowNs() : 0;
+        int timeoutMs = 0;
+        // 忙轮询窗口内不会阻塞，也就不需要其他线程唤醒
+        bool spinning = busyPollUs_ > 0 &&
+            pollReturnTime_.microSecondsSinceEpoch() - lastActiveUs_ < busyPollUs_;
+        if(!spinning)
+        {
+            // 先标记polling_再检查任务队列：其他线程入队后要么看到polling_并唤醒loop，
+            // 要么其任务在这里被看到，此时不阻塞
+            polling_.store(true);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            timeoutMs = pendingFunctors_.empty() ? Utils::kPollTimeMs : 0;
+        }
+        pollReturnTime_ = poller_->poll(timeoutMs, &activeChannels_);
+        polling_.store(false, std::memory_order_relaxed);
         ++iteration_;
+        if(spinning)
+        {
+            // 只有loop线程修改计数，不需要原子的读-改-写
+            spinPolls_.store(spinPolls_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+        else if(timeoutMs != 0)
+        {
+            blockingPolls_.store(blockingPolls_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+        if(!activeChannels_.empty() || !pendingFunctors_.empty())
+        {
+            lastActiveUs_ = pollReturnTime_.microSecondsSinceEpoch();
+        }
+
+        int64_t dispatchStart = measure ? LoopStats::nowNs() : 0;
 
         /// 处理channel
         eventHandling_ = true;
@@ -100,7 +136,14 @@ void EventLoop::loop()
         }
         currentActiveChannel_ = nullptr;
         eventHandling_ = false;
-        doPendingFunctors();
+        int64_t functorStart = measure ? LoopStats::nowNs() : 0;
+        size_t numFunctors = doPendingFunctors();
+        if(measure)
+        {
+            stats_.recordIteration(dispatchStart - pollStart, functorStart - dispatchStart,
+                                   LoopStats::nowNs() - functorStart,
+                                   activeChannels_.size(), numFunctors);
+        }
     }
 
     LOG_DEBUG << "EventLoop " << this << " stop looping";
@@ -109,6 +152,15 @@ void EventLoop::loop()
     quit_.store(false);
 }
 
+void EventLoop::setBusyPoll(int spinUs, int socketBusyPollUs)
+{
+    Utils::assertInLoopThread(this);
+    busyPollUs_ = spinUs > 0 ? spinUs : 0;
+    socketBusyPollUs_ = socketBusyPollUs > 0 ? socketBusyPollUs : 0;
+    // 开启后先进入忙轮询窗口
+    lastActiveUs_ = Timestamp::now().microSecondsSinceEpoch();
+}
+
 void EventLoop::quit()
 {
     quit_.store(true);
@@ -126,19 +178,22 @@ void EventLoop::runInLoop(Functor cb)
     }
     else
     {
-        queueInLoop(cb);
+        queueInLoop(std::move(cb));
     }
 }
 
 void EventLoop::queueInLoop(Functor cb)
 {
+    pendingFunctors_.push(std::move(cb));
+    // loop线程自己投递的任务会在下一次poll前被发现，无需唤醒
+    if(!isInLoopThread())
     {
-        std::lock_guard<std::mutex> lock(mutex_);
-        pendingFunctors_.push_back(cb);
-    }
-    if(!isInLoopThread() || callingPendingFunctors_)
-    {
-        wakeup();
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        // 多个线程同时投递时只有一个会写wakeupFd
+        if(polling_.load(std::memory_order_relaxed) && polling_.exchange(false))
+        {
+            wakeup();
+        }
     }
 }
 
@@ -157,21 +212,13 @@ void EventLoop::handleRead()
     }
 }
 
-void EventLoop::doPendingFunctors()
+size_t EventLoop::doPendingFunctors()
 {
-    std::vector<Functor> functors;
     callingPendingFunctors_ = true;
-    
-    {
-        std::lock_guard<std::mutex> lock(mutex_);
-        pendingFunctors_.swap(functors);
-    }
-
-    for(const Functor& func: functors)
-    {
-        func();
-    }
+    // 执行期间新加入的任务留到下一轮循环
+    size_t n = pendingFunctors_.consume([](Functor& func) { func(); });
     callingPendingFunctors_ = false;
+    return n;
 }
 
 void EventLoop::wakeup()
@@ -205,6 +252,11 @@ bool EventLoop::hasChannel(Channel *channel)
     return poller_->hasChannel(channel);
 }
 
+int64_t EventLoop::elidedPollerUpdateCount() const
+{
+    return poller_->elidedUpdateCount();
+}
+
 Timer *EventLoop::runAt(Timestamp time, TimerCallback cb)
 {
     return timerQueue_->addTimer(std::move(cb), time, 0.0);
@@ -3,12 +3,14 @@
 #include "base/noncopyable.h"
 #include "base/Timestamp.h"
 #include "base/CurrentThread.h"
+#include "base/MpscQueue.h"
+#include "base/BufferPool.h"
+#include "event/LoopStats.h"
 #include "timer/TimerQueue.h"
 
 #include <functional>
 #include <vector>
 #include <atomic>
-#include <mutex>
 
 namespace Utils
 {
@@ -22,7 +24,7 @@ class Poller
 class EventLoop: noncopyable
 {
 public:
-    using Functor = std::function<void()>;
+    using Functor = SmallTask;
     EventLoop(/* args */);
     ~EventLoop();
 
@@ -41,7 +43,7 @@ public:
     void runInLoop(Functor cb);
 
     /// @brief 将函数加入队列，唤醒对应循环线程并执行
-    /// 可以被其他线程调用
+    /// 可以被其他线程调用。只有loop阻塞在poll中时才会写wakeupFd
     void queueInLoop(Functor cb);
 
     // channel的相关操作，通过调用poller下的相关方法实现
@@ -51,6 +53,8 @@ public:
     void updateChannel(Channel* channel);
     void removeChannel(Channel* channel);
     bool hasChannel(Channel* channel);
+    /// @brief poller合并或抵消、没有产生系统调用的channel更新次数，可以被其他线程调用
+    int64_t elidedPollerUpdateCount() const;
 
     // timer的相关操作，向队列中添加定时器
     Timer* runAt(Timestamp time, TimerCallback cb);
@@ -60,12 +64,37 @@ public:
 
     bool isInLoopThread() const { return threadId_ == CurrentThread::tid(); }
 
+    /// @brief 开启自适应忙轮询。最近一次有事件或任务后的spinUs微秒内以0超时调用poll，
+    /// 持续空闲超过该时间后恢复阻塞等待。spinUs为0时关闭。
+    /// @param socketBusyPollUs 大于0时，该loop上新建立的连接会设置SO_BUSY_POLL
+    /// @note 只能在loop线程中调用（例如在EventLoopThread的初始化回调中）
+    void setBusyPoll(int spinUs, int socketBusyPollUs = 0);
+    int busyPollUs() const { return busyPollUs_; }
+    /// @note 只能在loop线程中调用
+    int socketBusyPollUs() const { return socketBusyPollUs_; }
+    /// @brief 忙轮询时以0超时调用poll的次数，可以被其他线程调用
+    int64_t spinPollCount() const { return spinPolls_.load(std::memory_order_relaxed); }
+    /// @brief 阻塞调用poll的次数，可以被其他线程调用
+    int64_t blockingPollCount() const { return blockingPolls_.load(std::memory_order_relaxed); }
+
+    /// @brief 开启/关闭每轮循环的统计，可以被其他线程调用
+    void setStatsEnabled(bool on) { stats_.setEnabled(on); }
+    /// @brief 统计对象，供poller与连接记录系统调用次数
+    LoopStats& stats() { return stats_; }
+    /// @brief 读取统计快照，可以被其他线程调用
+    LoopStats::Snapshot statsSnapshot() const { return stats_.snapshot(); }
+
+    /// @brief 该loop上连接的缓冲区使用的内存池，只能在loop线程中分配与回收（其他线程回退到堆），
+    /// 命中/未命中计数可以被其他线程读取
+    BufferPool* bufferPool() { return &bufferPool_; }
+
     static EventLoop* getLoopOfCurrentThread(); 
 private:
     /// @brief wakupFd触发可读事件后，调用该函数读取以避免重复触发
     void handleRead();
     /// @brief 执行待执行的回调函数
-    void doPendingFunctors();
+    /// @return 执行的任务数
+    size_t doPendingFunctors();
     
     using ChannelList = std::vector<Channel*>;
 
@@ -73,11 +102,20 @@ private:
     std::atomic<bool> quit_; /* 表示是否有线程调用了quit()。多线程调用quit()可能会同时修改quit */
     bool eventHandling_;
     bool callingPendingFunctors_;
+    std::atomic<bool> polling_; /* loop是否（即将）阻塞在poll中，用于合并唤醒操作 */
 
     int64_t iteration_;
+    int busyPollUs_;            /* 忙轮询窗口，0表示不忙轮询 */
+    int socketBusyPollUs_;      /* 连接的SO_BUSY_POLL取值 */
+    int64_t lastActiveUs_;      /* 最近一次poll到事件或执行任务的时间 */
+    std::atomic<int64_t> spinPolls_;
+    std::atomic<int64_t> blockingPolls_;
     const pid_t threadId_;
     Timestamp pollReturnTime_;
 
+    /// @note 定时器与待执行的任务可能持有使用该池的缓冲区，池需要在它们之后被析构
+    BufferPool bufferPool_;
+
     int wakeupFd_;
     /// @note 需要注意声明的顺序。
     /// 由于channel在析构时会检查自己是否在对应poller中，故poller需要在channel后被析构
@@ -88,7 +126,7 @@ private:
     ChannelList activeChannels_;    /* 被激活的channels */
     Channel* currentActiveChannel_;
 
-    mutable std::mutex mutex_;  /* pendingFunctor的互斥锁 */
-    std::vector<Functor> pendingFunctors_;
+    MpscQueue<Functor> pendingFunctors_;   /* 其他线程投递的任务，无锁队列 */
+    LoopStats stats_;
 };
 
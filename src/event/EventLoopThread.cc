@@ -1,5 +1,6 @@
 #include "event/EventLoopThread.h"
-#include "EventLoopThread.h"
+#include "base/CpuTopology.h"
+#include "logger/Logging.h"
 
 #include <assert.h>
 
@@ -7,7 +8,9 @@ EventLoopThread::EventLoopThread(EventLoopThreadInitCallback cb, const std::stri
     loop_(nullptr),
     thread_(std::bind(&EventLoopThread::threadFunc, this)),
     mutex_(),
-    initCallback_(cb)
+    initCallback_(cb),
+    cpu_(-1),
+    pinnedCpu_(-1)
 {
     sem_init(&sem_, false, 0);
 }
@@ -33,6 +36,17 @@ EventLoop *EventLoopThread::start()
 
 void EventLoopThread::threadFunc()
 {
+    if(cpu_ >= 0)
+    {
+        if(CpuTopology::pinCurrentThread(cpu_))
+        {
+            pinnedCpu_ = cpu_;
+        }
+        else
+        {
+            LOG_ERROR << "EventLoopThread::threadFunc - failed to pin thread to cpu " << cpu_;
+        }
+    }
     EventLoop loop;
 
     if(initCallback_)
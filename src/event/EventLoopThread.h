@@ -4,6 +4,7 @@
 #include "base/Thread.h"
 #include "event/EventLoop.h"
 
+#include <mutex>
 #include <semaphore.h>
 
 class EventLoopThread: noncopyable
@@ -15,6 +16,12 @@ public:
     ~EventLoopThread();
 
     EventLoop* start();
+
+    /// @brief 设置循环线程绑定的CPU，-1表示不绑定。必须在start前调用。
+    /// 线程在构造EventLoop前绑定，使loop及其连接的内存在本地NUMA节点上分配
+    void setCpu(int cpu) { cpu_ = cpu; }
+    /// @brief 循环线程实际绑定的CPU，未绑定或绑定失败时为-1。start返回后有效
+    int pinnedCpu() const { return pinnedCpu_; }
 private:
     void threadFunc();
 
@@ -23,4 +30,6 @@ private:
     std::mutex mutex_;
     sem_t sem_;
     EventLoopThreadInitCallback initCallback_;
+    int cpu_;
+    int pinnedCpu_;
 };
\ No newline at end of file
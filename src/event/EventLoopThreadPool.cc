@@ -1,5 +1,6 @@
 #include "EventLoopThreadPool.h"
 #include "EventLoopThread.h"
+#include "base/CpuTopology.h"
 
 #include <assert.h>
 
@@ -8,7 +9,8 @@ EventLoopThreadPool::EventLoopThreadPool(EventLoop *baseLoop, const std::string
     name_(name),
     started_(false),
     numThread_(0),
-    next_(0)
+    next_(0),
+    autoCpuAffinity_(false)
 {
 }
 
@@ -24,18 +26,42 @@ void EventLoopThreadPool::setNumThread(int num)
     numThread_ = num;
 }
 
+void EventLoopThreadPool::setCpuAffinity(const std::vector<int> &cpus)
+{
+    assert(!started_);
+    cpus_ = cpus;
+    autoCpuAffinity_ = false;
+}
+
+void EventLoopThreadPool::setAutoCpuAffinity()
+{
+    assert(!started_);
+    cpus_.clear();
+    autoCpuAffinity_ = true;
+}
+
 void EventLoopThreadPool::start(const EventLoopThreadInitCallback& cb)
 {
     assert(!started_);
     Utils::assertInLoopThread(baseLoop_);
 
+    if(autoCpuAffinity_)
+    {
+        cpus_ = CpuTopology::spreadOrder();
+    }
     loops_.reserve(numThread_);
+    cpuMap_.reserve(numThread_);
     for(int i = 0; i < numThread_; i++)
     {
         char buf[name_.size() + 32];
         snprintf(buf, sizeof buf, "%s%d", name_.c_str(), i);
         threads_.emplace_back(new EventLoopThread(cb, buf));
-        loops_[i] = threads_[i]->start();
+        if(!cpus_.empty())
+        {
+            threads_[i]->setCpu(cpus_[i % cpus_.size()]);
+        }
+        loops_.push_back(threads_[i]->start());
+        cpuMap_.push_back(threads_[i]->pinnedCpu());
     }
 
     if(numThread_ == 0 && cb)
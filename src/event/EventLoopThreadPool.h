@@ -14,6 +14,15 @@ public:
 
     void setNumThread(int num);
 
+    /// @brief 第i个循环线程绑定到cpus[i % cpus.size()]。必须在start前调用
+    void setCpuAffinity(const std::vector<int>& cpus);
+    /// @brief 按CpuTopology::spreadOrder()的顺序自动绑定循环线程。必须在start前调用
+    void setAutoCpuAffinity();
+
+    /// @brief 第i个循环线程实际绑定的CPU，未绑定为-1。start后有效，
+    /// 所在NUMA节点可以通过CpuTopology::nodeOfCpu获取
+    const std::vector<int>& cpuMap() const { return cpuMap_; }
+
     /// @brief 开启指定数量的循环线程。只能由线程池的创建者调用
     /// @param cb 循环线程调用前需要执行的回调函数
     void start(const EventLoopThreadInitCallback& cb = EventLoopThreadInitCallback());
@@ -34,4 +43,7 @@ private:
     int next_;
     std::vector<std::unique_ptr<EventLoopThread>> threads_;
     std::vector<EventLoop*> loops_;
+    bool autoCpuAffinity_;
+    std::vector<int> cpus_;     /* 设置的CPU列表 */
+    std::vector<int> cpuMap_;   /* 每个循环线程实际绑定的CPU */
 };
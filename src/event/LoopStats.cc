@@ -0,0 +1,141 @@
+#include "event/LoopStats.h"
+
+#include <stdio.h>
+
+namespace
+{
+int bucketOf(int64_t value)
+{
+    if(value <= 0)
+    {
+        return 0;
+    }
+    int bucket = 64 - __builtin_clzll(static_cast<uint64_t>(value));
+    return bucket < LoopStats::kNumBuckets ? bucket : LoopStats::kNumBuckets - 1;
+}
+}
+
+LoopStats::LoopStats():
+    enabled_(false),
+    iterations_(0),
+    pollNs_(0),
+    dispatchNs_(0),
+    functorNs_(0),
+    activeChannels_(0),
+    functors_(0),
+    pollerCtls_(0),
+    reads_(0),
+    writes_(0)
+{
+    AtomicHistogram* histograms[] = {&pollUs_, &dispatchUs_, &functorUs_,
+                                     &activeChannelsPerIteration_, &functorsPerDrain_};
+    for(AtomicHistogram* h: histograms)
+    {
+        for(Counter& bucket: h->buckets)
+        {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+void LoopStats::AtomicHistogram::record(int64_t value)
+{
+    add(buckets[bucketOf(value)], 1);
+}
+
+#ifndef MUDUO_NO_LOOP_STATS
+void LoopStats::recordIteration(int64_t pollNs, int64_t dispatchNs, int64_t functorNs,
+                                size_t activeChannels, size_t functors)
+{
+    add(iterations_, 1);
+    add(pollNs_, pollNs);
+    add(dispatchNs_, dispatchNs);
+    add(functorNs_, functorNs);
+    add(activeChannels_, static_cast<int64_t>(activeChannels));
+    add(functors_, static_cast<int64_t>(functors));
+    pollUs_.record(pollNs / 1000);
+    dispatchUs_.record(dispatchNs / 1000);
+    // 没有执行任务的轮次不计入任务耗时与每次执行的任务数
+    if(functors > 0)
+    {
+        functorUs_.record(functorNs / 1000);
+        functorsPerDrain_.record(static_cast<int64_t>(functors));
+    }
+    activeChannelsPerIteration_.record(static_cast<int64_t>(activeChannels));
+}
+#endif
+
+LoopStats::Snapshot LoopStats::snapshot() const
+{
+    Snapshot s;
+    s.iterations = iterations_.load(std::memory_order_relaxed);
+    s.pollNs = pollNs_.load(std::memory_order_relaxed);
+    s.dispatchNs = dispatchNs_.load(std::memory_order_relaxed);
+    s.functorNs = functorNs_.load(std::memory_order_relaxed);
+    s.activeChannels = activeChannels_.load(std::memory_order_relaxed);
+    s.functors = functors_.load(std::memory_order_relaxed);
+    s.pollerCtls = pollerCtls_.load(std::memory_order_relaxed);
+    s.reads = reads_.load(std::memory_order_relaxed);
+    s.writes = writes_.load(std::memory_order_relaxed);
+    const AtomicHistogram* from[] = {&pollUs_, &dispatchUs_, &functorUs_,
+                                     &activeChannelsPerIteration_, &functorsPerDrain_};
+    Histogram* to[] = {&s.pollUs, &s.dispatchUs, &s.functorUs,
+                       &s.activeChannelsPerIteration, &s.functorsPerDrain};
+    for(int i = 0; i < 5; i++)
+    {
+        for(int b = 0; b < kNumBuckets; b++)
+        {
+            to[i]->buckets[b] = from[i]->buckets[b].load(std::memory_order_relaxed);
+        }
+    }
+    return s;
+}
+
+int64_t LoopStats::Histogram::percentile(double p) const
+{
+    int64_t total = 0;
+    for(int64_t n: buckets)
+    {
+        total += n;
+    }
+    if(total == 0)
+    {
+        return 0;
+    }
+    int64_t rank = static_cast<int64_t>(p * static_cast<double>(total));
+    int64_t seen = 0;
+    for(int b = 0; b < kNumBuckets; b++)
+    {
+        seen += buckets[b];
+        if(seen > rank)
+        {
+            return b == 0 ? 0 : (static_cast<int64_t>(1) << b) - 1;
+        }
+    }
+    return (static_cast<int64_t>(1) << (kNumBuckets - 1)) - 1;
+}
+
+std::string LoopStats::Snapshot::toString() const
+{
+    char buf[512];
+    snprintf(buf, sizeof buf,
+             "iterations=%ld poll=%ldus dispatch=%ldus functors=%ldus "
+             "activeChannels=%ld(p50<=%ld p99<=%ld) functorsRun=%ld(p50<=%ld p99<=%ld) "
+             "pollUs p99<=%ld dispatchUs p99<=%ld pollerCtls=%ld reads=%ld writes=%ld",
+             static_cast<long>(iterations),
+             static_cast<long>(pollNs / 1000),
+             static_cast<long>(dispatchNs / 1000),
+             static_cast<long>(functorNs / 1000),
+             static_cast<long>(activeChannels),
+             static_cast<long>(activeChannelsPerIteration.percentile(0.5)),
+             static_cast<long>(activeChannelsPerIteration.percentile(0.99)),
+             static_cast<long>(functors),
+             static_cast<long>(functorsPerDrain.percentile(0.5)),
+             static_cast<long>(functorsPerDrain.percentile(0.99)),
+             static_cast<long>(pollUs.percentile(0.99)),
+             static_cast<long>(dispatchUs.percentile(0.99)),
+             static_cast<long>(pollerCtls),
+             static_cast<long>(reads),
+             static_cast<long>(writes));
+    return buf;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "base/noncopyable.h"
+
+#include <atomic>
+#include <string>
+#include <stdint.h>
+#include <time.h>
+
+/// @brief EventLoop每轮循环的统计：poll阻塞时间，channel分发时间，任务执行时间，
+/// 每轮的活跃channel数与任务数，以及poller更新/read/write系统调用次数。
+/// 计数只由loop线程写入，其他线程可以随时通过snapshot()读取（各字段之间不保证一致）。
+/// 定义MUDUO_NO_LOOP_STATS（cmake -DMUDUO_LOOP_STATS=OFF）时所有记录操作都是空函数，
+/// 否则需要通过EventLoop::setStatsEnabled在运行时开启，关闭时每个记录点只有一次分支。
+class LoopStats: noncopyable
+{
+public:
+    /// 直方图的桶：第0个桶记录0，第i个桶记录[2^(i-1), 2^i)，最后一个桶记录更大的值
+    static const int kNumBuckets = 24;
+
+    struct Histogram
+    {
+        int64_t buckets[kNumBuckets];
+
+        /// @brief 估计第p(0~1)分位数，返回所在桶的上界
+        int64_t percentile(double p) const;
+    };
+
+    struct Snapshot
+    {
+        int64_t iterations;
+        int64_t pollNs;         /* poll阻塞的总时间 */
+        int64_t dispatchNs;     /* Channel::handleEvent的总时间 */
+        int64_t functorNs;      /* doPendingFunctors的总时间 */
+        int64_t activeChannels;
+        int64_t functors;
+        int64_t pollerCtls;     /* epoll_ctl调用次数，或io_uring提交的poll注册/取消请求数 */
+        int64_t reads;
+        int64_t writes;
+        Histogram pollUs;
+        Histogram dispatchUs;
+        Histogram functorUs;
+        Histogram activeChannelsPerIteration;
+        Histogram functorsPerDrain;
+
+        std::string toString() const;
+    };
+
+    LoopStats();
+
+#ifdef MUDUO_NO_LOOP_STATS
+    static constexpr bool compiled() { return false; }
+    bool enabled() const { return false; }
+    void setEnabled(bool) {}
+    void recordIteration(int64_t, int64_t, int64_t, size_t, size_t) {}
+    void countPollerCtl() {}
+    void countRead() {}
+    void countWrite() {}
+#else
+    static constexpr bool compiled() { return true; }
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+    /// @brief 可以被其他线程调用，下一轮循环生效
+    void setEnabled(bool on) { enabled_.store(on, std::memory_order_relaxed); }
+
+    /// @brief 记录一轮循环。只能由loop线程调用
+    void recordIteration(int64_t pollNs, int64_t dispatchNs, int64_t functorNs,
+                         size_t activeChannels, size_t functors);
+
+    void countPollerCtl() { if(enabled()) { add(pollerCtls_, 1); } }
+    void countRead() { if(enabled()) { add(reads_, 1); } }
+    void countWrite() { if(enabled()) { add(writes_, 1); } }
+#endif
+
+    /// @brief 读取当前的统计值，可以被其他线程调用
+    Snapshot snapshot() const;
+
+    static int64_t nowNs()
+    {
+        struct timespec ts;
+        ::clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+private:
+    using Counter = std::atomic<int64_t>;
+
+    struct AtomicHistogram
+    {
+        Counter buckets[kNumBuckets];
+        void record(int64_t value);
+    };
+
+    /// 只有loop线程写入，不需要原子的读-改-写
+    static void add(Counter& counter, int64_t n)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    std::atomic<bool> enabled_;
+    Counter iterations_;
+    Counter pollNs_;
+    Counter dispatchNs_;
+    Counter functorNs_;
+    Counter activeChannels_;
+    Counter functors_;
+    Counter pollerCtls_;
+    Counter reads_;
+    Counter writes_;
+    AtomicHistogram pollUs_;
+    AtomicHistogram dispatchUs_;
+    AtomicHistogram functorUs_;
+    AtomicHistogram activeChannelsPerIteration_;
+    AtomicHistogram functorsPerDrain_;
+};
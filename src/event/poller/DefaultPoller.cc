@@ -1,7 +1,20 @@
 #include "event/poller/Poller.h"
 #include "event/poller/EpollPoller.h"
+#include "event/poller/IoUringPoller.h"
+#include "logger/Logging.h"
+
+#include <stdlib.h>
 
 Poller* Poller::newDefaultPoller(EventLoop* loop)
 {
+    // 设置环境变量MUDUO_USE_IO_URING以使用io_uring，内核不支持时回退到epoll
+    if(::getenv("MUDUO_USE_IO_URING"))
+    {
+        if(IoUringPoller::isSupported())
+        {
+            return new IoUringPoller(loop);
+        }
+        LOG_WARN << "io_uring is not supported, fall back to epoll";
+    }
     return new EpollPoller(loop);
-}
\ No newline at end of file
+}
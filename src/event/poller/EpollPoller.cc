@@ -1,6 +1,7 @@
 #include "event/poller/EpollPoller.h"
 #include "logger/Logging.h"
 
+#include <algorithm>
 #include <sys/epoll.h>
 #include <assert.h>
 
@@ -44,10 +45,18 @@ void EpollPoller::update(int op, Channel *channel)
 {
     epoll_event event;
     event.events = channel->events();
+    if(channel->isEdgeTriggered())
+    {
+        event.events |= EPOLLET;
+    }
     event.data.ptr = channel;
     int fd = channel->fd();
     LOG_DEBUG << "epoll_ctl op = " << operationToString(op)
     << " fd = " << fd << " event = { " << channel->eventToString() << " }";
+    FdState* state = stateOf(fd);
+    state->registered = op != EPOLL_CTL_DEL;
+    state->events = state->registered ? event.events : 0;
+    ownerLoop()->stats().countPollerCtl();
     if (::epoll_ctl(epollFd_, op, fd, &event) < 0)
     {
         if (op == EPOLL_CTL_DEL)
@@ -62,6 +71,73 @@ void EpollPoller::update(int op, Channel *channel)
 
 }
 
+void EpollPoller::markDirty(int fd)
+{
+    FdState* state = stateOf(fd);
+    if(!state->dirty)
+    {
+        state->dirty = true;
+        dirtyFds_.push_back(fd);
+    }
+    else
+    {
+        countElidedUpdate();
+    }
+}
+
+void EpollPoller::flushDirty()
+{
+    for(int fd: dirtyFds_)
+    {
+        FdState* state = &states_[fd];
+        state->dirty = false;
+        Channel* channel = findChannel(fd);
+        if(channel == nullptr)
+        {
+            // removeChannel已经立即从epoll中删除
+            continue;
+        }
+        uint32_t want = 0;
+        if(channel->index() == kAdded)
+        {
+            want = channel->events() | (channel->isEdgeTriggered() ? static_cast<uint32_t>(EPOLLET) : 0);
+        }
+        // 在同一轮循环中相互抵消的修改不会产生系统调用
+        if(!state->registered && want == 0)
+        {
+            countElidedUpdate();
+        }
+        else if(!state->registered)
+        {
+            update(EPOLL_CTL_ADD, channel);
+        }
+        else if(want == 0)
+        {
+            update(EPOLL_CTL_DEL, channel);
+        }
+        else if(want != state->events)
+        {
+            update(EPOLL_CTL_MOD, channel);
+        }
+        else
+        {
+            countElidedUpdate();
+        }
+    }
+    dirtyFds_.clear();
+}
+
+EpollPoller::FdState *EpollPoller::stateOf(int fd)
+{
+    assert(fd >= 0);
+    if(static_cast<size_t>(fd) >= states_.size())
+    {
+        FdState empty = {0, false, false};
+        states_.resize(std::max(static_cast<size_t>(fd) + 1, states_.size() * 2), empty);
+    }
+    return &states_[fd];
+}
+
 EpollPoller::EpollPoller(EventLoop *loop):
     Poller(loop),
     epollFd_(::epoll_create1(EPOLL_CLOEXEC)),
@@ -81,6 +157,7 @@ EpollPoller::~EpollPoller()
 Timestamp EpollPoller::poll(int timeoutMs, ChannelList *activeChannels)
 {
     this->assertInLoopThread();
+    flushDirty();
     int numEvents = ::epoll_wait(epollFd_, events_.data(), static_cast<int>(events_.size()), timeoutMs);
     Timestamp now = Timestamp::now();
     
@@ -114,47 +191,37 @@ void EpollPoller::updateChannel(Channel *channel)
     {
         if(index == kNew) //kNew
         {
-            assert(channels_.find(fd) == channels_.end());
-            channels_[fd] = channel;
+            assert(findChannel(fd) == nullptr);
+            addChannel(channel);
         }
         else              // kDeleted
         {
             // 移除channel时会保留其在channels中的键值对，故仍应该能被查询到
-            assert(channels_.find(fd) != channels_.end());
-            assert(channels_[fd] == channel);
+            assert(findChannel(fd) == channel);
         }
-
         channel->set_index(kAdded);
-        update(EPOLL_CTL_ADD, channel);
     }
-    else
+    else if (channel->isNoneEvent())
     {
         // 如果没有感兴趣事件，则移除
-        if (channel->isNoneEvent())
-        {
-            update(EPOLL_CTL_DEL, channel);
-            channel->set_index(kDeleted);
-        }
-        else
-        {
-            update(EPOLL_CTL_MOD, channel);
-        }
+        channel->set_index(kDeleted);
     }
-
+    // epoll_ctl推迟到下一次poll前，一次发送/写完常见的MOD(+OUT)、MOD(-OUT)会相互抵消
+    markDirty(fd);
 }
 
 void EpollPoller::removeChannel(Channel *channel)
 {
     this->assertInLoopThread();
     int fd = channel->fd();
-    assert(channels_.find(fd) != channels_.end());
-    assert(channels_[fd] == channel);
+    assert(findChannel(fd) == channel);
     const int index = channel->index();
     assert(channel->isNoneEvent());
     assert(index == kAdded || index == kDeleted);
 
-    channels_.erase(fd);
-    if(index == kAdded)
+    eraseChannel(fd);
+    // fd随后可能被关闭并复用，必须立即删除，避免epoll中残留指向已析构channel的指针
+    if(stateOf(fd)->registered)
     {
         update(EPOLL_CTL_DEL, channel);
     }
@@ -3,6 +3,7 @@
 #include "event/poller/Poller.h"
 
 #include <vector>
+#include <stdint.h>
 
 struct epoll_event;
 
@@ -24,11 +25,29 @@ private:
     /// @brief 为相应的channel设置接收到的事件类型，并记录被更新的channels
     void fillActiveChannels(int numEvents, ChannelList* activeChannls) const;
 
-    /// @brief 调用epoll_ctl 
+    /// @brief 调用epoll_ctl，并记录fd在epoll实例中的注册状态
     void update(int op, Channel* channel);
 
+    /// @brief 记录fd的感兴趣事件有变化，poll前统一提交
+    void markDirty(int fd);
+
+    /// @brief 对每个被修改过的fd，比较channel当前的感兴趣事件与epoll中的注册状态，只提交净变化
+    void flushDirty();
+
+    /// @brief fd在epoll实例中的注册状态
+    struct FdState
+    {
+        uint32_t events;    /* 已注册的事件（包括EPOLLET） */
+        bool registered;
+        bool dirty;         /* 是否在dirtyFds_中 */
+    };
+
+    FdState* stateOf(int fd);
+
     using EventList = std::vector<epoll_event>;
 
     int epollFd_;
     EventList events_;
+    std::vector<FdState> states_;   /* 以fd为下标 */
+    std::vector<int> dirtyFds_;
 };
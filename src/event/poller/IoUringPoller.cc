@@ -0,0 +1,387 @@
+#include "event/poller/IoUringPoller.h"
+#include "event/Channel.h"
+#include "logger/Logging.h"
+
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/epoll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <algorithm>
+
+namespace
+{
+enum ChannelStatus
+{
+    kNew = -1,      /* 未被添加到poller中 */
+    kAdded = 1,     /* 已被添加到poller中，且有感兴趣事件 */
+    kDeleted = 2    /* 被添加到poller中，但没有感兴趣事件 */
+};
+
+/// user_data的最高位标记poller内部请求（如POLL_REMOVE），其完成事件直接丢弃
+const uint64_t kInternalUserData = 1ULL << 63;
+const uint32_t kGenMask = 0x7fffffff;
+
+inline uint64_t makeUserData(int fd, uint32_t gen)
+{
+    return (static_cast<uint64_t>(gen & kGenMask) << 32) | static_cast<uint32_t>(fd);
+}
+
+int sysSetup(unsigned entries, io_uring_params* p)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, p));
+}
+
+int sysEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags, const void* arg, size_t argSize)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, arg, argSize));
+}
+}
+
+IoUringPoller::IoUringPoller(EventLoop *loop):
+    Poller(loop),
+    ringFd_(-1),
+    sqRing_(MAP_FAILED),
+    sqRingSize_(0),
+    sqesSize_(0),
+    sqeTail_(0),
+    pending_(0),
+    cqRing_(MAP_FAILED),
+    cqRingSize_(0)
+{
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ringFd_ = sysSetup(kRingEntries, &params);
+    if(ringFd_ < 0)
+    {
+        LOG_FATAL << "IoUringPoller::IoUringPoller - io_uring_setup";
+    }
+    if(!(params.features & IORING_FEAT_EXT_ARG))
+    {
+        LOG_FATAL << "IoUringPoller::IoUringPoller - IORING_FEAT_EXT_ARG is not supported";
+    }
+
+    sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if(singleMmap)
+    {
+        sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+    }
+
+    sqRing_ = ::mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQ_RING);
+    if(sqRing_ == MAP_FAILED)
+    {
+        LOG_FATAL << "IoUringPoller::IoUringPoller - mmap sq ring";
+    }
+    if(singleMmap)
+    {
+        cqRing_ = sqRing_;
+    }
+    else
+    {
+        cqRing_ = ::mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_CQ_RING);
+        if(cqRing_ == MAP_FAILED)
+        {
+            LOG_FATAL << "IoUringPoller::IoUringPoller - mmap cq ring";
+        }
+    }
+
+    sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = ::mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ringFd_, IORING_OFF_SQES);
+    if(sqes == MAP_FAILED)
+    {
+        LOG_FATAL << "IoUringPoller::IoUringPoller - mmap sqes";
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    char* sq = static_cast<char*>(sqRing_);
+    sqHead_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqMask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqEntries_ = params.sq_entries;
+    sqeTail_ = *sqTail_;
+    // sqe下标与提交队列下标一一对应，只需初始化一次
+    unsigned* array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    for(unsigned i = 0; i < sqEntries_; i++)
+    {
+        array[i] = i;
+    }
+
+    char* cq = static_cast<char*>(cqRing_);
+    cqHead_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqMask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+}
+
+IoUringPoller::~IoUringPoller()
+{
+    ::munmap(sqes_, sqesSize_);
+    if(cqRing_ != sqRing_)
+    {
+        ::munmap(cqRing_, cqRingSize_);
+    }
+    ::munmap(sqRing_, sqRingSize_);
+    ::close(ringFd_);
+}
+
+bool IoUringPoller::isSupported()
+{
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = sysSetup(1, &params);
+    if(fd < 0)
+    {
+        return false;
+    }
+    ::close(fd);
+    return params.features & IORING_FEAT_EXT_ARG;
+}
+
+Timestamp IoUringPoller::poll(int timeoutMs, ChannelList *activeChannels)
+{
+    this->assertInLoopThread();
+    flushDirty();
+
+    // 完成队列中已有事件时不再阻塞
+    bool cqEmpty = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE) == *cqHead_;
+    int ret = enter(cqEmpty ? 1 : 0, timeoutMs);
+    Timestamp now = Timestamp::now();
+
+    if(ret < 0 && errno != ETIME && errno != EINTR)
+    {
+        LOG_ERROR << "IoUringPoller::poll()";
+    }
+
+    size_t numBefore = activeChannels->size();
+    fillActiveChannels(activeChannels);
+    if(activeChannels->size() > numBefore)
+    {
+        LOG_DEBUG << activeChannels->size() - numBefore << " events happened";
+    }
+    else
+    {
+        LOG_DEBUG << "no event happend";
+    }
+    return now;
+}
+
+void IoUringPoller::updateChannel(Channel *channel)
+{
+    this->assertInLoopThread();
+    const int index = channel->index();
+    int fd = channel->fd();
+    if(index == kNew || index == kDeleted)
+    {
+        if(index == kNew)
+        {
+            assert(findChannel(fd) == nullptr);
+            addChannel(channel);
+            stateOf(fd)->channel = channel;
+        }
+        else
+        {
+            assert(findChannel(fd) == channel);
+        }
+        channel->set_index(kAdded);
+    }
+    else if(channel->isNoneEvent())
+    {
+        channel->set_index(kDeleted);
+    }
+    markDirty(fd);
+}
+
+void IoUringPoller::removeChannel(Channel *channel)
+{
+    this->assertInLoopThread();
+    int fd = channel->fd();
+    assert(findChannel(fd) == channel);
+    const int index = channel->index();
+    assert(channel->isNoneEvent());
+    assert(index == kAdded || index == kDeleted);
+
+    eraseChannel(fd);
+    PollState* state = stateOf(fd);
+    if(state->armed)
+    {
+        cancelPoll(fd, state);
+    }
+    // 保留dirty标记与版本号，flushDirty时会跳过已移除的fd
+    state->channel = nullptr;
+    channel->set_index(kNew);
+}
+
+IoUringPoller::PollState* IoUringPoller::stateOf(int fd)
+{
+    assert(fd >= 0);
+    if(static_cast<size_t>(fd) >= states_.size())
+    {
+        PollState empty = {nullptr, 0, 0, false};
+        states_.resize(std::max(static_cast<size_t>(fd) + 1, states_.size() * 2), empty);
+    }
+    return &states_[fd];
+}
+
+void IoUringPoller::markDirty(int fd)
+{
+    PollState* state = stateOf(fd);
+    if(!state->dirty)
+    {
+        state->dirty = true;
+        dirtyFds_.push_back(fd);
+    }
+    else
+    {
+        countElidedUpdate();
+    }
+}
+
+void IoUringPoller::flushDirty()
+{
+    for(int fd: dirtyFds_)
+    {
+        PollState* state = &states_[fd];
+        state->dirty = false;
+        Channel* channel = state->channel;
+        if(channel == nullptr)
+        {
+            continue;
+        }
+        uint32_t want = channel->index() == kAdded ? channel->events() : 0;
+        // 在同一轮循环中相互抵消的修改不会产生任何请求
+        if(state->armed == want)
+        {
+            countElidedUpdate();
+            continue;
+        }
+        if(state->armed)
+        {
+            cancelPoll(fd, state);
+        }
+        if(want)
+        {
+            state->armed = want;
+            armPoll(fd, state);
+        }
+    }
+    dirtyFds_.clear();
+}
+
+void IoUringPoller::armPoll(int fd, PollState *state)
+{
+    ++state->gen;
+    ownerLoop()->stats().countPollerCtl();
+    io_uring_sqe* sqe = getSqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = state->armed;
+    sqe->user_data = makeUserData(fd, state->gen);
+}
+
+void IoUringPoller::cancelPoll(int fd, PollState *state)
+{
+    ownerLoop()->stats().countPollerCtl();
+    io_uring_sqe* sqe = getSqe();
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = makeUserData(fd, state->gen);
+    sqe->user_data = kInternalUserData;
+    state->armed = 0;
+}
+
+io_uring_sqe *IoUringPoller::getSqe()
+{
+    if(sqeTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= sqEntries_)
+    {
+        if(enter(0, 0) < 0)
+        {
+            LOG_ERROR << "IoUringPoller::getSqe - submit";
+        }
+    }
+    io_uring_sqe* sqe = &sqes_[sqeTail_ & sqMask_];
+    memset(sqe, 0, sizeof(*sqe));
+    ++sqeTail_;
+    ++pending_;
+    return sqe;
+}
+
+int IoUringPoller::enter(unsigned minComplete, int timeoutMs)
+{
+    if(minComplete == 0 && pending_ == 0)
+    {
+        return 0;
+    }
+    __atomic_store_n(sqTail_, sqeTail_, __ATOMIC_RELEASE);
+
+    unsigned flags = 0;
+    __kernel_timespec ts;
+    io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    if(minComplete > 0)
+    {
+        flags |= IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+        arg.sigmask_sz = _NSIG / 8;
+        if(timeoutMs >= 0)
+        {
+            ts.tv_sec = timeoutMs / 1000;
+            ts.tv_nsec = static_cast<long long>(timeoutMs % 1000) * 1000 * 1000;
+            arg.ts = reinterpret_cast<uint64_t>(&ts);
+        }
+    }
+
+    int ret;
+    do
+    {
+        ret = sysEnter(ringFd_, pending_, minComplete, flags,
+                       flags ? &arg : nullptr, flags ? sizeof(arg) : 0);
+    } while(ret < 0 && errno == EINTR && minComplete == 0);
+
+    if(ret > 0)
+    {
+        pending_ -= std::min(pending_, static_cast<unsigned>(ret));
+    }
+    return ret;
+}
+
+void IoUringPoller::fillActiveChannels(ChannelList *activeChannels)
+{
+    unsigned head = *cqHead_;
+    unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    for(; head != tail; ++head)
+    {
+        const io_uring_cqe& cqe = cqes_[head & cqMask_];
+        if(cqe.user_data & kInternalUserData)
+        {
+            continue;
+        }
+        int fd = static_cast<int>(cqe.user_data & 0xffffffff);
+        uint32_t gen = static_cast<uint32_t>(cqe.user_data >> 32);
+        if(static_cast<size_t>(fd) >= states_.size())
+        {
+            continue;
+        }
+        PollState* state = &states_[fd];
+        // 过期的完成事件（已被取消或重新注册的poll请求）
+        if(state->channel == nullptr || !state->armed || gen != (state->gen & kGenMask))
+        {
+            continue;
+        }
+        // one-shot请求已失效，下一次poll前需要重新注册
+        state->armed = 0;
+        markDirty(fd);
+
+        int revents = cqe.res >= 0 ? cqe.res : static_cast<int>(EPOLLERR);
+        state->channel->set_revents(revents);
+        activeChannels->push_back(state->channel);
+    }
+    __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+}
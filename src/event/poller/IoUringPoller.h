@@ -0,0 +1,81 @@
+#pragma once
+
+#include "event/poller/Poller.h"
+
+#include <vector>
+#include <stdint.h>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+/// @brief 基于io_uring poll请求实现的Poller。
+/// 每个channel对应一个one-shot的IORING_OP_POLL_ADD请求，触发后在下一次poll前重新注册，以模拟LT语义。
+/// 感兴趣事件的变化只记录在dirty列表中，在poll前统一写入提交队列，
+/// 并与等待操作合并为一次io_uring_enter调用，从而省去每次Channel::update的epoll_ctl。
+class IoUringPoller: public Poller
+{
+public:
+    IoUringPoller(EventLoop* loop);
+    ~IoUringPoller();
+
+    Timestamp poll(int timeoutMs, ChannelList* activeChannels) override;
+    void updateChannel(Channel* channel) override;
+    void removeChannel(Channel* channel) override;
+
+    /// @brief 检查内核是否支持所需的io_uring特性（IORING_FEAT_EXT_ARG, 5.11+）
+    static bool isSupported();
+
+private:
+    static const unsigned kRingEntries = 256;
+
+    /// @brief 每个fd的注册情况
+    struct PollState
+    {
+        Channel* channel;
+        uint32_t gen;       /* 当前poll请求的版本号，用于过滤过期的完成事件 */
+        uint32_t armed;     /* 已提交给内核的感兴趣事件，0表示未注册 */
+        bool dirty;         /* 是否已在dirtyFds_中 */
+    };
+
+    void markDirty(int fd);
+    /// @brief 将dirty列表中的变化写入提交队列
+    void flushDirty();
+
+    void armPoll(int fd, PollState* state);
+    void cancelPoll(int fd, PollState* state);
+
+    /// @brief 获取一个空闲的sqe。提交队列已满时先提交已有请求
+    io_uring_sqe* getSqe();
+    /// @brief 调用io_uring_enter提交请求，并按需等待完成事件
+    int enter(unsigned minComplete, int timeoutMs);
+
+    /// @brief 读取完成队列，为相应的channel设置接收到的事件类型，并记录被更新的channels
+    void fillActiveChannels(ChannelList* activeChannels);
+
+    PollState* stateOf(int fd);
+
+    int ringFd_;
+
+    // 提交队列（mmap到用户态的内核数据结构）
+    void* sqRing_;
+    size_t sqRingSize_;
+    unsigned* sqHead_;
+    unsigned* sqTail_;
+    unsigned sqMask_;
+    unsigned sqEntries_;
+    io_uring_sqe* sqes_;
+    size_t sqesSize_;
+    unsigned sqeTail_;      /* 本地维护的队尾，提交时写回sqTail_ */
+    unsigned pending_;      /* 尚未提交的sqe数量 */
+
+    // 完成队列
+    void* cqRing_;
+    size_t cqRingSize_;
+    unsigned* cqHead_;
+    unsigned* cqTail_;
+    unsigned cqMask_;
+    io_uring_cqe* cqes_;
+
+    std::vector<PollState> states_;  /* 以fd为下标 */
+    std::vector<int> dirtyFds_;
+};
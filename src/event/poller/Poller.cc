@@ -1,9 +1,13 @@
 #include "event/poller/Poller.h"
 #include "event/EventLoop.h"
+#include "event/Channel.h"
+
+#include <algorithm>
 
 Poller::Poller(EventLoop* loop):
+    channels_(),
     loop_(loop),
-    channels_()
+    elidedUpdates_(0)
 {
 }
 
@@ -12,6 +16,15 @@ Poller::~Poller() = default;
 bool Poller::hasChannel(Channel* channel) const
 {
   Utils::assertInLoopThread(loop_);
-  auto it = channels_.find(channel->fd());
-  return (it != channels_.end() && it->second == channel);
+  return findChannel(channel->fd()) == channel;
+}
+
+void Poller::addChannel(Channel* channel)
+{
+    size_t fd = static_cast<size_t>(channel->fd());
+    if(fd >= channels_.size())
+    {
+        channels_.resize(std::max(fd + 1, channels_.size() * 2), nullptr);
+    }
+    channels_[fd] = channel;
 }
\ No newline at end of file
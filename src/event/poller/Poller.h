@@ -4,7 +4,7 @@
 #include "base/Timestamp.h"
 #include "base/noncopyable.h"
 
-#include <unordered_map>
+#include <atomic>
 #include <vector>
 
 class Channel;
@@ -30,17 +30,39 @@ public:
     /// 只能由loop线程调用
     virtual void removeChannel(Channel* channel) = 0;
 
-    /// @brief 查找是否注册了对应的channel
+    /// @brief 查找是否注册了对应的channel，O(1)
     virtual bool hasChannel(Channel* channel) const;
 
+    /// @brief 被合并或相互抵消、因而没有产生系统调用的updateChannel次数。
+    /// 可以被其他线程调用
+    int64_t elidedUpdateCount() const { return elidedUpdates_.load(std::memory_order_relaxed); }
+
     /// @brief 设置默认的poller（Epoller）
     static Poller* newDefaultPoller(EventLoop* loop);
 
     void assertInLoopThread() const { Utils::assertInLoopThread(loop_); }
 
 protected:
-    using ChannelMap = std::unordered_map<int, Channel*>;
+    EventLoop* ownerLoop() const { return loop_; }
+
+    /// @brief 返回fd上注册的channel，未注册时返回nullptr
+    Channel* findChannel(int fd) const
+    {
+        return static_cast<size_t>(fd) < channels_.size() ? channels_[fd] : nullptr;
+    }
+    /// @brief 登记channel，表长不足时按需扩容
+    void addChannel(Channel* channel);
+    void eraseChannel(int fd) { channels_[fd] = nullptr; }
+    /// @brief 只由loop线程修改，不需要原子的读-改-写
+    void countElidedUpdate()
+    {
+        elidedUpdates_.store(elidedUpdates_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    /// fd是从小到大分配的整数，直接以fd为下标，避免哈希表的节点分配与查找开销
+    using ChannelMap = std::vector<Channel*>;
     ChannelMap channels_;
 private:
     EventLoop* loop_;
+    std::atomic<int64_t> elidedUpdates_;
 };
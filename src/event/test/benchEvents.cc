@@ -0,0 +1,123 @@
+#include "base/Timestamp.h"
+#include "event/Channel.h"
+#include "event/EventLoop.h"
+#include "logger/Logging.h"
+
+#include <vector>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+/// 默认日志级别下单个loop每秒能分发的事件数，用于观察日志对事件处理热路径的影响。
+/// 不替换日志输出：默认级别(INFO)下事件处理路径上不应该有任何日志被格式化或输出。
+/// ring:   numPairs个socketpair中有numActive个令牌循环传递，每次读事件把令牌交给下一个socketpair。
+/// filter: 被运行时级别过滤掉的LOG_DEBUG语句的开销。
+
+namespace
+{
+const int kNumPairs = 100;
+const int kNumActive = 10;
+const int kNumEvents = 1000000;
+const int kNumStatements = 10000000;
+
+class Ring
+{
+public:
+    explicit Ring(EventLoop* loop):
+        loop_(loop),
+        fds_(kNumPairs * 2),
+        count_(0)
+    {
+        for(int i = 0; i < kNumPairs; i++)
+        {
+            if(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, &fds_[i * 2]) < 0)
+            {
+                perror("socketpair");
+                exit(1);
+            }
+            channels_.emplace_back(new Channel(loop_, fds_[i * 2]));
+            channels_.back()->setReadCallback(std::bind(&Ring::onRead, this, i));
+            channels_.back()->enableReading();
+        }
+    }
+
+    ~Ring()
+    {
+        for(auto& channel: channels_)
+        {
+            channel->disableAll();
+            channel->remove();
+        }
+        for(int fd: fds_)
+        {
+            ::close(fd);
+        }
+    }
+
+    void start()
+    {
+        for(int i = 0; i < kNumActive; i++)
+        {
+            send(i * (kNumPairs / kNumActive));
+        }
+    }
+
+private:
+    void send(int idx)
+    {
+        char c = 'x';
+        if(::write(fds_[idx * 2 + 1], &c, 1) != 1)
+        {
+            perror("write");
+        }
+    }
+
+    void onRead(int idx)
+    {
+        char c;
+        if(::read(fds_[idx * 2], &c, 1) != 1)
+        {
+            return;
+        }
+        send((idx + 1) % kNumPairs);
+        if(++count_ == kNumEvents)
+        {
+            loop_->quit();
+        }
+    }
+
+    EventLoop* loop_;
+    std::vector<int> fds_;
+    std::vector<std::unique_ptr<Channel>> channels_;
+    int count_;
+};
+}
+
+int main()
+{
+    printf("MUDUO_MIN_LOG_LEVEL=%d, runtime level=%d\n",
+           MUDUO_MIN_LOG_LEVEL, static_cast<int>(Logger::logLevel()));
+    {
+        EventLoop loop;
+        Ring ring(&loop);
+        ring.start();
+        Timestamp start = Timestamp::now();
+        loop.loop();
+        double seconds = timeDifference(Timestamp::now(), start);
+        printf("ring:   %d events in %.3f s, %.0f events/s\n",
+               kNumEvents, seconds, kNumEvents / seconds);
+    }
+    {
+        std::string arg("argument");
+        Timestamp start = Timestamp::now();
+        for(int i = 0; i < kNumStatements; i++)
+        {
+            LOG_DEBUG << "filtered " << i << arg;
+        }
+        double seconds = timeDifference(Timestamp::now(), start);
+        printf("filter: %.2f ns per filtered LOG_DEBUG\n", seconds * 1e9 / kNumStatements);
+    }
+    return 0;
+}
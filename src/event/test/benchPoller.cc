@@ -0,0 +1,242 @@
+#include "base/Timestamp.h"
+#include "event/Channel.h"
+#include "event/EventLoop.h"
+#include "logger/Logging.h"
+
+#include <vector>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+/// EpollPoller与IoUringPoller的对比测试。
+/// pingpong: numPairs个socketpair中有numActive个令牌循环传递，每次读事件都会
+///           enableWriting()/disableWriting()一次，模拟一次可以直接写完的send。
+/// churn:    每次读事件都会关闭当前socketpair并新建一个，模拟连接频繁建立与断开。
+/// 两种poller分别在子进程中运行（通过MUDUO_USE_IO_URING选择）。
+
+namespace
+{
+const int kNumPairs = 1000;
+const int kNumActive = 100;
+const int kNumEvents = 500000;
+
+struct Pair
+{
+    int fds[2];
+    std::unique_ptr<Channel> channel;
+};
+
+class PingPong
+{
+public:
+    explicit PingPong(EventLoop* loop):
+        loop_(loop),
+        pairs_(kNumPairs),
+        count_(0)
+    {
+        for(int i = 0; i < kNumPairs; i++)
+        {
+            Pair& p = pairs_[i];
+            if(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, p.fds) < 0)
+            {
+                perror("socketpair");
+                exit(1);
+            }
+            p.channel.reset(new Channel(loop_, p.fds[0]));
+            p.channel->setReadCallback(std::bind(&PingPong::onRead, this, i));
+            p.channel->enableReading();
+        }
+    }
+
+    ~PingPong()
+    {
+        for(Pair& p: pairs_)
+        {
+            p.channel->disableAll();
+            p.channel->remove();
+            ::close(p.fds[0]);
+            ::close(p.fds[1]);
+        }
+    }
+
+    void start()
+    {
+        for(int i = 0; i < kNumActive; i++)
+        {
+            send(i * (kNumPairs / kNumActive));
+        }
+    }
+
+private:
+    void send(int idx)
+    {
+        char c = 'x';
+        if(::write(pairs_[idx].fds[1], &c, 1) != 1)
+        {
+            perror("write");
+        }
+    }
+
+    void onRead(int idx)
+    {
+        Pair& p = pairs_[idx];
+        char c;
+        if(::read(p.fds[0], &c, 1) != 1)
+        {
+            return;
+        }
+        p.channel->enableWriting();
+        p.channel->disableWriting();
+        send((idx + 1) % kNumPairs);
+        if(++count_ == kNumEvents)
+        {
+            loop_->quit();
+        }
+    }
+
+    EventLoop* loop_;
+    std::vector<Pair> pairs_;
+    int count_;
+};
+
+class Churn
+{
+public:
+    explicit Churn(EventLoop* loop):
+        loop_(loop),
+        count_(0)
+    {
+    }
+
+    ~Churn()
+    {
+        for(Pair* p: live_)
+        {
+            destroy(p);
+        }
+    }
+
+    void start()
+    {
+        for(int i = 0; i < kNumActive; i++)
+        {
+            create();
+        }
+    }
+
+private:
+    void create()
+    {
+        Pair* p = new Pair;
+        if(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, p->fds) < 0)
+        {
+            perror("socketpair");
+            exit(1);
+        }
+        p->channel.reset(new Channel(loop_, p->fds[0]));
+        p->channel->setReadCallback(std::bind(&Churn::onRead, this, p));
+        p->channel->enableReading();
+        live_.push_back(p);
+        char c = 'x';
+        if(::write(p->fds[1], &c, 1) != 1)
+        {
+            perror("write");
+        }
+    }
+
+    void destroy(Pair* p)
+    {
+        p->channel->disableAll();
+        p->channel->remove();
+        ::close(p->fds[0]);
+        ::close(p->fds[1]);
+        delete p;
+    }
+
+    void onRead(Pair* p)
+    {
+        char c;
+        if(::read(p->fds[0], &c, 1) != 1)
+        {
+            return;
+        }
+        for(size_t i = 0; i < live_.size(); i++)
+        {
+            if(live_[i] == p)
+            {
+                live_[i] = live_.back();
+                live_.pop_back();
+                break;
+            }
+        }
+        // channel不能在自己的回调中析构
+        loop_->queueInLoop(std::bind(&Churn::destroy, this, p));
+        if(++count_ == kNumEvents / 10)
+        {
+            loop_->quit();
+            return;
+        }
+        create();
+    }
+
+    EventLoop* loop_;
+    std::vector<Pair*> live_;
+    int count_;
+};
+
+void run(const char* name)
+{
+    EventLoop loop;
+    {
+        PingPong pingpong(&loop);
+        pingpong.start();
+        Timestamp start = Timestamp::now();
+        loop.loop();
+        double seconds = timeDifference(Timestamp::now(), start);
+        printf("%-9s pingpong: %d events in %.3f s, %.0f events/s, %ld updates elided\n",
+               name, kNumEvents, seconds, kNumEvents / seconds,
+               static_cast<long>(loop.elidedPollerUpdateCount()));
+    }
+    {
+        Churn churn(&loop);
+        churn.start();
+        Timestamp start = Timestamp::now();
+        loop.loop();
+        double seconds = timeDifference(Timestamp::now(), start);
+        printf("%-9s churn:    %d connections in %.3f s, %.0f connections/s\n",
+               name, kNumEvents / 10, seconds, kNumEvents / 10 / seconds);
+    }
+    fflush(stdout);
+}
+
+void runInChild(const char* name, bool useIoUring)
+{
+    pid_t pid = ::fork();
+    if(pid == 0)
+    {
+        if(useIoUring)
+        {
+            ::setenv("MUDUO_USE_IO_URING", "1", 1);
+        }
+        else
+        {
+            ::unsetenv("MUDUO_USE_IO_URING");
+        }
+        run(name);
+        exit(0);
+    }
+    ::waitpid(pid, nullptr, 0);
+}
+}
+
+int main()
+{
+    Logger::setOutput([](const char*, int) {});
+    runInChild("epoll", false);
+    runInChild("io_uring", true);
+    return 0;
+}
@@ -0,0 +1,128 @@
+#include "base/CurrentThread.h"
+#include "base/Thread.h"
+#include "base/Timestamp.h"
+#include "event/EventLoop.h"
+#include "event/EventLoopThread.h"
+#include "logger/Logging.h"
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <stdio.h>
+#include <time.h>
+
+/// 跨线程runInLoop的吞吐量与延迟测试。
+/// throughput: numProducers个线程各向同一个loop连续投递numTasks个任务，
+///             任务记录从投递到执行的时间，结束后统计吞吐量与延迟分布（包含排队时间）。
+/// pingpong:   每次只投递一个任务并等待其执行完毕，测量空闲loop被唤醒并执行任务的延迟。
+///             分别测试阻塞等待与开启忙轮询（EventLoop::setBusyPoll）的loop。
+
+namespace
+{
+const int kNumTasks = 200000;
+const int kNumRounds = 20000;
+
+int64_t nowNs()
+{
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+void run(int numProducers)
+{
+    EventLoopThread loopThread;
+    EventLoop* loop = loopThread.start();
+
+    const int total = numProducers * kNumTasks;
+    std::vector<int64_t> latencies;
+    latencies.reserve(total);
+    std::atomic<int> done(0);
+
+    int64_t start = nowNs();
+    std::vector<std::unique_ptr<Thread>> producers;
+    for(int i = 0; i < numProducers; i++)
+    {
+        producers.emplace_back(new Thread([loop, &latencies, &done]()
+        {
+            for(int j = 0; j < kNumTasks; j++)
+            {
+                int64_t posted = nowNs();
+                loop->runInLoop([posted, &latencies, &done]()
+                {
+                    // 只在loop线程中访问latencies
+                    latencies.push_back(nowNs() - posted);
+                    done.fetch_add(1, std::memory_order_release);
+                });
+            }
+        }));
+        producers.back()->start();
+    }
+    for(auto& t: producers)
+    {
+        t->join();
+    }
+    while(done.load(std::memory_order_acquire) < total)
+    {
+        CurrentThread::sleepUsec(100);
+    }
+    double seconds = static_cast<double>(nowNs() - start) / 1e9;
+
+    std::sort(latencies.begin(), latencies.end());
+    printf("producers=%2d  %9.0f tasks/s  latency p50=%6.1fus p99=%8.1fus max=%8.1fus\n",
+           numProducers, total / seconds,
+           latencies[total / 2] / 1e3,
+           latencies[static_cast<size_t>(total * 0.99)] / 1e3,
+           latencies.back() / 1e3);
+    fflush(stdout);
+}
+
+void runPingPong(int spinUs)
+{
+    EventLoopThread loopThread;
+    EventLoop* loop = loopThread.start();
+    if(spinUs > 0)
+    {
+        loop->runInLoop([loop, spinUs]() { loop->setBusyPoll(spinUs); });
+    }
+
+    std::vector<int64_t> latencies;
+    latencies.reserve(kNumRounds);
+    for(int i = 0; i < kNumRounds; i++)
+    {
+        std::atomic<bool> done(false);
+        int64_t posted = nowNs();
+        loop->runInLoop([&done]() { done.store(true, std::memory_order_release); });
+        while(!done.load(std::memory_order_acquire))
+        {
+            CurrentThread::sleepUsec(0);
+        }
+        latencies.push_back(nowNs() - posted);
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    printf("pingpong spin=%dus round trip p50=%6.1fus p99=%8.1fus max=%8.1fus"
+           " (spin polls=%ld, blocking polls=%ld)\n",
+           spinUs,
+           latencies[kNumRounds / 2] / 1e3,
+           latencies[static_cast<size_t>(kNumRounds * 0.99)] / 1e3,
+           latencies.back() / 1e3,
+           static_cast<long>(loop->spinPollCount()),
+           static_cast<long>(loop->blockingPollCount()));
+    fflush(stdout);
+}
+}
+
+int main()
+{
+    Logger::setOutput([](const char*, int) {});
+    int producers[] = {1, 2, 4, 8, 16};
+    for(int n: producers)
+    {
+        run(n);
+    }
+    runPingPong(0);
+    runPingPong(1000);
+    return 0;
+}
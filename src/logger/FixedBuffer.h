@@ -3,6 +3,7 @@
 #include "base/noncopyable.h"
 
 #include <memory>
+#include <string>
 #include <string.h>
 
 const int kSmallBuffer = 4*1024;
@@ -3,6 +3,7 @@
 #include "FixedBuffer.h"
 
 #include <string.h>
+#include <stdio.h>
 
 
 /// @brief 使用4KB缓冲区封装的流
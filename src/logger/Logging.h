@@ -93,10 +93,29 @@ inline Logger::LogLevel Logger::logLevel()
 // 获取errno信息
 // const char* getErrnoMsg(int savedErrno);
 
-#define LOG_DEBUG if (Logger::logLevel() <= Logger::DEBUG) \
+/// 编译期的最低日志级别（Logger::LogLevel的数值）。低于该级别的日志语句的条件是常量false，
+/// 语句连同参数表达式一起被编译器移除。默认在定义了NDEBUG时为INFO，否则为TRACE，
+/// 可以通过-DMUDUO_MIN_LOG_LEVEL=N（cmake -DMUDUO_MIN_LOG_LEVEL=N）覆盖
+#ifndef MUDUO_MIN_LOG_LEVEL
+#ifdef NDEBUG
+#define MUDUO_MIN_LOG_LEVEL 2
+#else
+#define MUDUO_MIN_LOG_LEVEL 0
+#endif
+#endif
+
+/// 先比较编译期常量，再比较运行时级别，两者都满足时才构造Logger
+#define MUDUO_LOG_ENABLED(level) \
+  (Logger::level >= MUDUO_MIN_LOG_LEVEL && Logger::logLevel() <= Logger::level)
+
+#define LOG_TRACE if (MUDUO_LOG_ENABLED(TRACE)) \
+  Logger(__FILE__, __LINE__, Logger::TRACE, __func__).stream()
+#define LOG_DEBUG if (MUDUO_LOG_ENABLED(DEBUG)) \
   Logger(__FILE__, __LINE__, Logger::DEBUG, __func__).stream()
-#define LOG_INFO if (Logger::logLevel() <= Logger::INFO) \
+#define LOG_INFO if (MUDUO_LOG_ENABLED(INFO)) \
   Logger(__FILE__, __LINE__).stream()
-#define LOG_WARN Logger(__FILE__, __LINE__, Logger::WARN).stream()
-#define LOG_ERROR Logger(__FILE__, __LINE__, Logger::ERROR).stream()
-#define LOG_FATAL Logger(__FILE__, __LINE__, Logger::FATAL).stream()
\ No newline at end of file
+#define LOG_WARN if (MUDUO_LOG_ENABLED(WARN)) \
+  Logger(__FILE__, __LINE__, Logger::WARN).stream()
+#define LOG_ERROR if (MUDUO_LOG_ENABLED(ERROR)) \
+  Logger(__FILE__, __LINE__, Logger::ERROR).stream()
+#define LOG_FATAL Logger(__FILE__, __LINE__, Logger::FATAL).stream()
@@ -3,16 +3,25 @@
 #include "net/InetAddress.h"
 #include "event/EventLoop.h"
 
+#include <errno.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <assert.h>
 
+namespace
+{
+/// 内核资源不足时暂停接受连接的时间
+const double kAcceptRetryDelay = 0.1;
+}
+
 Acceptor::Acceptor(EventLoop *loop, const InetAddress &listenAddr, bool reusePort):
     loop_(loop),
     acceptSocket_(Socket::createNoblockingOrDie(listenAddr.family())),
     acceptChannel_(loop, acceptSocket_.fd()),
     listening_(false),
-    idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC))
+    idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC)),
+    maxAcceptsPerRead_(kDefaultMaxAcceptsPerRead),
+    retryTimer_(nullptr)
 {
     assert(idleFd_ >= 0);
     acceptSocket_.setReuseAddr(true);
@@ -23,6 +32,10 @@ Acceptor::Acceptor(EventLoop *loop, const InetAddress &listenAddr, bool reusePor
 
 Acceptor::~Acceptor()
 {
+    if(retryTimer_)
+    {
+        loop_->cancel(retryTimer_);
+    }
     acceptChannel_.disableAll();
     acceptChannel_.remove();
     ::close(idleFd_);
@@ -39,32 +52,92 @@ void Acceptor::listen()
 void Acceptor::handleRead()
 {
     Utils::assertInLoopThread(loop_);
-    InetAddress peerAddr;
-    int connFd = acceptSocket_.accept(&peerAddr);
-    if(connFd >= 0)
+    accepted_.clear();
+    while(static_cast<int>(accepted_.size()) < maxAcceptsPerRead_)
     {
-        if(newConnectionCallback_)
+        InetAddress peerAddr;
+        int connFd = acceptSocket_.accept(&peerAddr);
+        if(connFd >= 0)
+        {
+            accepted_.push_back(AcceptedConnection{connFd, peerAddr});
+            continue;
+        }
+        int savedErrno = errno;
+        if(savedErrno == EAGAIN)
         {
-            newConnectionCallback_(connFd, peerAddr);
+            break;
         }
-        else
+        // 对端在accept前放弃了连接, 继续接受下一个
+        if(savedErrno == ECONNABORTED || savedErrno == EPROTO || savedErrno == EINTR)
         {
-            ::close(connFd);
+            continue;
+        }
+        LOG_ERROR << "in Acceptor::handleRead, errno = " << savedErrno;
+        // 监听socket是水平触发的, 连接留在队列中时每轮循环都会再次触发.
+        // 描述符耗尽时拒绝该连接; 其他资源不足(ENOBUFS、ENOMEM)或拒绝失败时暂停接受.
+        // EPERM表示连接已被防火墙丢弃, 不需要处理
+        bool rejected = (savedErrno == EMFILE || savedErrno == ENFILE) && rejectWithIdleFd();
+        if(!rejected && savedErrno != EPERM)
+        {
+            pauseAccepting();
+        }
+        break;
+    }
+    if(accepted_.empty())
+    {
+        return;
+    }
+
+    if(newConnectionsCallback_)
+    {
+        newConnectionsCallback_(accepted_);
+    }
+    else if(newConnectionCallback_)
+    {
+        for(const AcceptedConnection& conn: accepted_)
+        {
+            newConnectionCallback_(conn.sockfd, conn.peerAddr);
         }
     }
     else
     {
-        LOG_ERROR << "in Acceptor::handleRead";
-        // Read the section named "The special problem of
-        // accept()ing when you can't" in libev's doc.
-        // By Marc Lehmann, author of libev.
-        /// 进程打开的文件描述符达到上限, 关闭预占用的idleFd, 通过accept获取连接的fd并关闭连接.  
-        if (errno == EMFILE)
+        for(const AcceptedConnection& conn: accepted_)
         {
-            ::close(idleFd_);
-            idleFd_ = ::accept(acceptSocket_.fd(), NULL, NULL);
-            ::close(idleFd_);
-            idleFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+            ::close(conn.sockfd);
         }
     }
 }
+
+bool Acceptor::rejectWithIdleFd()
+{
+    // Read the section named "The special problem of
+    // accept()ing when you can't" in libev's doc.
+    // By Marc Lehmann, author of libev.
+    /// 打开的文件描述符达到上限, 关闭预占用的idleFd, 通过accept获取连接的fd并关闭连接.
+    /// 系统范围的上限(ENFILE)同样适用: 关闭idleFd后空出的描述符立刻被accept使用
+    if(idleFd_ >= 0)
+    {
+        ::close(idleFd_);
+    }
+    int connFd = ::accept(acceptSocket_.fd(), NULL, NULL);
+    if(connFd >= 0)
+    {
+        ::close(connFd);
+    }
+    idleFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+    return connFd >= 0;
+}
+
+void Acceptor::pauseAccepting()
+{
+    if(retryTimer_)
+    {
+        return;
+    }
+    acceptChannel_.disableReading();
+    retryTimer_ = loop_->runAfter(kAcceptRetryDelay, [this]()
+    {
+        retryTimer_ = nullptr;
+        acceptChannel_.enableReading();
+    });
+}
@@ -1,32 +1,62 @@
 #pragma once
 
 #include "base/Callback.h"
+#include "net/InetAddress.h"
 #include "net/Socket.h"
 #include "event/Channel.h"
 
-class InetAddress;
+#include <vector>
+
 class EventLoop;
+class Timer;
 
 class Acceptor: noncopyable
 {
 public:
+    /// 一次可读事件中接受的一个连接
+    struct AcceptedConnection
+    {
+        int sockfd;
+        InetAddress peerAddr;
+    };
     using NewConnectionCallback = std::function<void(int sockfd, const InetAddress& address)>;
+    using NewConnectionsCallback = std::function<void(const std::vector<AcceptedConnection>& conns)>;
+    /// 每次可读事件默认最多接受的连接数
+    static const int kDefaultMaxAcceptsPerRead = 16;
+
     Acceptor(EventLoop* loop, const InetAddress& listenAddr, bool reusePort);
     ~Acceptor();
 
+    /// @brief 逐个交付接受的连接
     void setNewConnectionCallback(const NewConnectionCallback& cb)
     { newConnectionCallback_ = cb; }
+    /// @brief 一次可读事件中接受的所有连接一起交付, 设置后不再调用NewConnectionCallback
+    void setNewConnectionsCallback(const NewConnectionsCallback& cb)
+    { newConnectionsCallback_ = cb; }
+
+    /// @brief 每次可读事件中循环accept, 直到没有待接受的连接或达到n个.
+    /// 剩余的连接在下一轮循环中接受, 不会长时间占用loop
+    void setMaxAcceptsPerRead(int n) { maxAcceptsPerRead_ = n > 0 ? n : 1; }
 
     void listen();
 
     bool listening() const {return listening_;}
 private:
     void handleRead();
+    /// @brief 描述符耗尽时释放idleFd, 接受并立即关闭一个连接, 再重新预占idleFd
+    /// @return 是否拒绝了一个连接
+    bool rejectWithIdleFd();
+    /// @brief 暂时停止监听可读事件, kAcceptRetryDelay秒后恢复, 避免水平触发的监听socket空转
+    void pauseAccepting();
 
     EventLoop* loop_;
     Socket acceptSocket_;   /* 监听socket */
     Channel acceptChannel_;     
     NewConnectionCallback newConnectionCallback_;
+    NewConnectionsCallback newConnectionsCallback_;
     bool listening_;
     int idleFd_;
+    int maxAcceptsPerRead_;
+    std::vector<AcceptedConnection> accepted_;  /* 本次可读事件接受的连接, 复用以避免分配 */
+    Timer* retryTimer_;     /* pauseAccepting后恢复监听的定时器, 没有暂停时为nullptr */
 };
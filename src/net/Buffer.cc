@@ -1,42 +1,99 @@
 #include "net/Buffer.h"
 
 #include <errno.h>
+#include <sys/ioctl.h>
 #include <sys/uio.h>
 #include <unistd.h>
 #include "Buffer.h"
 
-const char Buffer::kCRLF[] = "\r\n";
+const size_t Buffer::kInitialSize;
+const size_t Buffer::kMinReadHint;
+const size_t Buffer::kMaxReadHint;
 
-ssize_t Buffer::readFd(int fd, int* savedErrno)
+void Buffer::reallocate(size_t extra, size_t minCapacity)
 {
-    char extraBuf[65536] = {0};
+    size_t readable = readableBytes();
+    size_t capacity = 0;
+    char* buffer = BufferPool::allocate(pool_,
+        std::max(kCheapPrepend + readable + extra, minCapacity), &capacity);
+    std::copy(beginRead(), beginWrite(), buffer + kCheapPrepend);
+    BufferPool::deallocate(pool_, buffer_, capacity_);
+    buffer_ = buffer;
+    capacity_ = capacity;
+    readerIndex_ = kCheapPrepend;
+    writerIndex_ = readerIndex_ + readable;
+}
+
+void Buffer::shrink(size_t reserve)
+{
+    if(BufferPool::roundUp(kCheapPrepend + readableBytes() + reserve) < capacity_)
+    {
+        reallocate(reserve, 0);
+        // 突发流量中学到的readHint会让下一次读取立刻扩容回去，重新开始估计
+        readHint_ = kInitialReadHint;
+        smallReads_ = 0;
+    }
+}
+
+ssize_t Buffer::readFd(int fd, int* savedErrno, bool queryAvailable)
+{
+    // 每个loop线程共享一个暂存区，只用于容纳超出预留空间的数据，不需要清零
+    static __thread char t_extraBuf[65536];
+
+    size_t expected = readHint_;
+    int available = 0;
+    if(queryAvailable && ::ioctl(fd, FIONREAD, &available) == 0 && available > 0)
+    {
+        expected = std::min(static_cast<size_t>(available), kMaxReadHint);
+    }
+    ensureWritable(expected);
 
-    // 用一个额外缓冲区用于暂存socket的输出
     struct iovec vec[2];
     size_t writable = writableBytes();
     vec[0].iov_base = beginWrite(); 
     vec[0].iov_len = writable;
-    vec[1].iov_base = extraBuf; 
-    vec[1].iov_len = sizeof(extraBuf);
+    vec[1].iov_base = t_extraBuf; 
+    vec[1].iov_len = sizeof(t_extraBuf);
 
     // 如果buffer_可写空间>=64kb，则不使用额外缓冲区
-    int vecNum = writable < sizeof(extraBuf)? 2 : 1;
+    int vecNum = writable < sizeof(t_extraBuf)? 2 : 1;
     ssize_t n = readv(fd, vec, vecNum);
 
     if(n < 0)
     {
         *savedErrno = errno;
+        return n;
     }
-    else if(n <= writable)
+    else if(static_cast<size_t>(n) <= writable)
     {
         writerIndex_ += n;
     }
     else
     {
-        writerIndex_ = buffer_.size();
-        append(extraBuf, n-writable);
+        writerIndex_ = capacity_;
+        append(t_extraBuf, n-writable);
     }
 
+    // 类似netty的AdaptiveRecvByteBufAllocator：读满预留空间时加倍，
+    // 连续两次读取不到四分之一时减半
+    size_t read = static_cast<size_t>(n);
+    if(read >= writable)
+    {
+        readHint_ = std::min(readHint_ * 2, kMaxReadHint);
+        smallReads_ = 0;
+    }
+    else if(read < readHint_ / 4)
+    {
+        if(++smallReads_ >= 2)
+        {
+            readHint_ = std::max(readHint_ / 2, kMinReadHint);
+            smallReads_ = 0;
+        }
+    }
+    else
+    {
+        smallReads_ = 0;
+    }
     return n;
 }
 
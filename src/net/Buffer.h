@@ -1,4 +1,9 @@
 #pragma once 
+#include "base/BufferPool.h"
+#include "base/ByteCodec.h"
+#include "base/ByteScan.h"
+#include "base/StringPiece.h"
+
 #include <vector>
 #include <algorithm>
 #include <string>
@@ -29,42 +34,83 @@ public:
 
     static const size_t kCheapPrepend = 8;
     static const size_t kInitialSize = 1024;
+    /// readFd预留空间的初始值与范围
+    static const size_t kInitialReadHint = 1024;
+    static const size_t kMinReadHint = 256;
+    static const size_t kMaxReadHint = 256 * 1024;
     
-    explicit Buffer(size_t initialSize = kInitialSize):
-        buffer_(kCheapPrepend + initialSize),
+    /// @param pool 存储空间所属的内存池（一般是连接所在loop的池），为nullptr时直接使用堆
+    explicit Buffer(size_t initialSize = kInitialSize, BufferPool* pool = nullptr):
+        pool_(pool),
         readerIndex_(kCheapPrepend),
-        writerIndex_(kCheapPrepend)
+        writerIndex_(kCheapPrepend),
+        readHint_(kInitialReadHint),
+        smallReads_(0)
     {
+        buffer_ = BufferPool::allocate(pool_, kCheapPrepend + initialSize, &capacity_);
     }
-    
+
+    ~Buffer()
+    {
+        BufferPool::deallocate(pool_, buffer_, capacity_);
+    }
+
+    Buffer(const Buffer& rhs):
+        Buffer(rhs.readableBytes(), rhs.pool_)
+    {
+        append(rhs.peek(), rhs.readableBytes());
+    }
+
+    Buffer& operator=(Buffer rhs)
+    {
+        swap(rhs);
+        return *this;
+    }
+
     void swap(Buffer& rhs)
     {
+        std::swap(pool_, rhs.pool_);
         std::swap(buffer_, rhs.buffer_);
+        std::swap(capacity_, rhs.capacity_);
         std::swap(readerIndex_, rhs.readerIndex_);
         std::swap(writerIndex_, rhs.writerIndex_);
+        std::swap(readHint_, rhs.readHint_);
+        std::swap(smallReads_, rhs.smallReads_);
     }
 
     size_t readableBytes() const {return writerIndex_ - readerIndex_; }
-    size_t writableBytes() const {return buffer_.size() - writerIndex_; }
+    size_t writableBytes() const {return capacity_ - writerIndex_; }
     size_t prependableBytes() const {return readerIndex_; }
     /// @brief 获取readerindex位置地址
     const char* peek() const {return begin() + readerIndex_;}
 
+    /// 在可读数据中查找分隔符（ByteScan的向量化实现），start为开始查找的位置，默认为peek()。找不到返回nullptr
+
     const char* findCRLF(const char* start = nullptr) const
     {
         if(start == nullptr) start = beginRead();
         assert(start >= beginRead());
         assert(start <= beginWrite());
-        const char* crlf = std::search(start, beginWrite(), kCRLF, kCRLF+2);
-        return crlf == beginWrite()? nullptr : crlf;
+        return ByteScan::findCRLF(start, beginWrite());
     }
     const char* findEOL(const char* start = nullptr) const
+    {
+        return findByte('\n', start);
+    }
+    const char* findByte(char c, const char* start = nullptr) const
+    {
+        if(start == nullptr) start = beginRead();
+        assert(start >= beginRead());
+        assert(start <= beginWrite());
+        return ByteScan::findByte(start, beginWrite(), c);
+    }
+    /// @brief 第一个属于set[0, setLen)的字节
+    const char* findAny(const char* set, size_t setLen, const char* start = nullptr) const
     {
         if(start == nullptr) start = beginRead();
         assert(start >= beginRead());
         assert(start <= beginWrite());
-        const void* eol = memchr(beginRead(), '\n', readableBytes());
-        return static_cast<const char*>(eol);
+        return ByteScan::findAny(start, beginWrite(), set, setLen);
     }
 
     /// @brief 复位操作，用于读取缓冲区
@@ -94,6 +140,20 @@ public:
         writerIndex_ = kCheapPrepend;
     }
 
+    /// @brief 丢弃数据，把存储空间还给内存池，之后直接使用堆。
+    /// 缓冲区可能比池（所属的loop）存活得更久时，在池销毁前调用
+    void detachPool()
+    {
+        retrieveAll();
+        if(pool_ == nullptr)
+        {
+            return;
+        }
+        BufferPool::deallocate(pool_, buffer_, capacity_);
+        pool_ = nullptr;
+        buffer_ = BufferPool::allocate(nullptr, kCheapPrepend, &capacity_);
+    }
+
     std::string retrieveAsString(size_t len)
     {
         assert(len <= readableBytes());
@@ -150,26 +210,24 @@ public:
         std::copy(d, d+len, begin()+readerIndex_);
     }
 
-    void shrink(size_t reserve)
-    {
-        // FIXME: use vector::shrink_to_fit() in C++ 11 if possible.
-        Buffer other;
-        other.ensureWritable(readableBytes()+reserve);
-        other.append(beginRead(), readableBytes());
-        swap(other);
-    }
+    /// @brief 把存储空间缩小到恰好能容纳可读数据与reserve字节，多余的空间交还给内存池。
+    /// 缩小后readHint恢复为初始值
+    void shrink(size_t reserve);
 
     size_t internalCapacity() const
     {
-        return buffer_.capacity();
+        return capacity_;
     }
 
+    /// @brief 存储空间所属的内存池，为nullptr时使用堆
+    BufferPool* pool() const { return pool_; }
+
     char* beginRead() {return begin() + readerIndex_; }
     char* beginWrite() {return begin() + writerIndex_; }
     const char* beginRead() const {return begin() + readerIndex_; }
     const char* beginWrite() const {return begin() + writerIndex_; }
 
-    /// 基于int类型的数据读取和写入
+    /// 基于int类型的数据读取和写入（主机字节序）
     template<typename T>
     void peekInt(T* value) const
     {
@@ -197,13 +255,140 @@ public:
     }
 
 
-    /// @brief 直接从缓冲区读取数据，通过readv(2)实现
-    ssize_t readFd(int fd, int* savedErrno);
+    /// 二进制协议的编解码（base/ByteCodec.h）。BE/LE为指定的字节序，
+    /// peek/read在数据不足时断言失败，解码不可信的输入时先检查长度或使用reader()
+
+    template<typename T>
+    void appendBE(T value)
+    {
+        ensureWritable(sizeof(T));
+        ByteCodec::storeBE(beginWrite(), value);
+        writerIndex_ += sizeof(T);
+    }
+
+    template<typename T>
+    void appendLE(T value)
+    {
+        ensureWritable(sizeof(T));
+        ByteCodec::storeLE(beginWrite(), value);
+        writerIndex_ += sizeof(T);
+    }
+
+    template<typename T>
+    T peekBE(size_t offset = 0) const
+    {
+        assert(readableBytes() >= offset + sizeof(T));
+        return ByteCodec::loadBE<T>(peek() + offset);
+    }
+
+    template<typename T>
+    T peekLE(size_t offset = 0) const
+    {
+        assert(readableBytes() >= offset + sizeof(T));
+        return ByteCodec::loadLE<T>(peek() + offset);
+    }
+
+    template<typename T>
+    T readBE()
+    {
+        T value = peekBE<T>();
+        retrieve(sizeof(T));
+        return value;
+    }
+
+    template<typename T>
+    T readLE()
+    {
+        T value = peekLE<T>();
+        retrieve(sizeof(T));
+        return value;
+    }
+
+    void appendVarint(uint64_t value)
+    {
+        ensureWritable(ByteCodec::kMaxVarintLength);
+        writerIndex_ = ByteCodec::encodeVarint(beginWrite(), value) - begin();
+    }
+
+    void appendVarintSigned(int64_t value)
+    {
+        appendVarint(ByteCodec::zigzagEncode(value));
+    }
+
+    /// @brief 解码开头的varint
+    /// @return 消耗的字节数；数据不完整返回0，格式错误返回-1
+    int peekVarint(uint64_t* value) const
+    {
+        return ByteCodec::decodeVarint(peek(), beginWrite(), value);
+    }
+
+    /// @brief 同peekVarint，成功时丢弃varint的字节
+    int readVarint(uint64_t* value)
+    {
+        int n = peekVarint(value);
+        if(n > 0)
+        {
+            retrieve(n);
+        }
+        return n;
+    }
+
+    /// 不复制数据的视图，在下一次写入（append/readFd等）之前有效
+
+    StringPiece toStringPiece() const
+    {
+        return StringPiece(peek(), readableBytes());
+    }
+
+    StringPiece peekView(size_t len, size_t offset = 0) const
+    {
+        assert(readableBytes() >= offset + len);
+        return StringPiece(peek() + offset, len);
+    }
+
+    /// @brief 返回开头len字节的视图并丢弃这些字节。丢弃不会修改数据，视图在下一次写入前有效
+    StringPiece readView(size_t len)
+    {
+        StringPiece view = peekView(len);
+        retrieve(len);
+        return view;
+    }
+
+    /// @brief 在可读数据上顺序解码，配合retrieve(reader.consumed())使用
+    ByteCodec::ByteReader reader() const
+    {
+        return ByteCodec::ByteReader(peek(), readableBytes());
+    }
+
+    /// @brief 预留至少maxLen字节并返回写入位置，直接在缓冲区中编码（例如通过ByteCodec::ByteWriter），
+    /// 之后调用commitAppend提交实际写入的长度
+    char* beginAppend(size_t maxLen)
+    {
+        ensureWritable(maxLen);
+        return beginWrite();
+    }
+
+    void commitAppend(size_t len)
+    {
+        assert(len <= writableBytes());
+        writerIndex_ += len;
+    }
+
+    /// @brief 直接从fd读取数据到缓冲区，通过readv(2)实现。
+    /// 读取前按最近的读取量（或FIONREAD）预留可写空间，使数据尽量直接落在缓冲区中；
+    /// 超出的部分先读到线程共享的暂存区再追加
+    /// @param queryAvailable 是否先通过ioctl(FIONREAD)查询可读字节数（多一次系统调用）
+    ssize_t readFd(int fd, int* savedErrno, bool queryAvailable = false);
+    /// @brief 下一次readFd预留的可写空间
+    size_t readHint() const { return readHint_; }
     /// @brief 将缓冲区数据输出到fd中, 通过write实现
     ssize_t writeFd(int fd, int* savedErrno);
 private:
-    const char* begin() const {return &(*buffer_.begin()); }
-    char* begin() {return &(*buffer_.begin()); }
+    const char* begin() const {return buffer_; }
+    char* begin() {return buffer_; }
+
+    /// @brief 换用至少能容纳kCheapPrepend + readable + extra字节的存储空间，可读数据被移到开头
+    void reallocate(size_t extra, size_t minCapacity);
 
     /// @brief 扩容函数。如果prependable和writable空间足够，则通过前移readable部分以腾出空间
     /// @param len 
@@ -211,7 +396,8 @@ private:
     {
         if(writableBytes() + prependableBytes() < len + kCheapPrepend)
         {
-            buffer_.resize(writerIndex_+len);
+            // 超过内存池最大级别后按倍数扩容，避免每次追加都复制全部数据
+            reallocate(len, 2 * capacity_);
         }
         else
         {
@@ -223,11 +409,13 @@ private:
         }
     }
 
-    std::vector<char> buffer_;
+    BufferPool* pool_;
+    char* buffer_;
+    size_t capacity_;
     size_t readerIndex_;
     size_t writerIndex_;
-
-    static const char kCRLF[];
+    size_t readHint_;       /* 根据最近的读取量调整的预留空间 */
+    int smallReads_;        /* 连续远小于readHint_的读取次数 */
 };
 
 template void Buffer::peekInt<int8_t>(int8_t*) const;
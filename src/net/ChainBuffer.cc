@@ -0,0 +1,283 @@
+#include "net/ChainBuffer.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+ChainBuffer::ChainBuffer(BufferPool* pool):
+    pool_(pool),
+    readable_(0),
+    fileBytes_(0),
+    zeroCopyThreshold_(0),
+    zeroCopySeq_(0)
+{
+}
+
+ChainBuffer::~ChainBuffer()
+{
+    retrieveAll();
+}
+
+void ChainBuffer::pushSlab()
+{
+    Slab slab;
+    slab.data = BufferPool::allocate(pool_, kSlabSize, &slab.capacity);
+    slab.begin = 0;
+    slab.end = 0;
+    slab.fileFd = -1;
+    slabs_.push_back(slab);
+}
+
+void ChainBuffer::popSlab()
+{
+    Slab& front = slabs_.front();
+    if(front.isFile())
+    {
+        ::close(front.fileFd);
+    }
+    else if(!front.isShared())
+    {
+        BufferPool::deallocate(pool_, front.data, front.capacity);
+    }
+    slabs_.pop_front();
+}
+
+void ChainBuffer::appendFile(int fd, off_t offset, size_t length)
+{
+    if(length == 0)
+    {
+        ::close(fd);
+        return;
+    }
+    Slab slab;
+    slab.data = nullptr;
+    slab.capacity = 0;
+    slab.begin = static_cast<size_t>(offset);
+    slab.end = slab.begin + length;
+    slab.fileFd = fd;
+    slabs_.push_back(slab);
+    readable_ += length;
+    fileBytes_ += length;
+}
+
+void ChainBuffer::appendShared(std::shared_ptr<const void> owner, const void *data, size_t len)
+{
+    if(len == 0)
+    {
+        return;
+    }
+    assert(owner);
+    Slab slab;
+    slab.data = const_cast<char*>(static_cast<const char*>(data));
+    slab.capacity = len;
+    slab.begin = 0;
+    slab.end = len;
+    slab.fileFd = -1;
+    slab.owner = std::move(owner);
+    slabs_.push_back(std::move(slab));
+    readable_ += len;
+}
+
+void ChainBuffer::handleZeroCopyCompletion(uint32_t lo, uint32_t hi)
+{
+    // 完成通知一般按编号顺序到达，编号回绕时用无符号减法判断区间
+    auto done = [lo, hi](const std::pair<uint32_t, std::shared_ptr<const void>>& pending)
+    {
+        return pending.first - lo <= hi - lo;
+    };
+    while(!zeroCopyPending_.empty() && done(zeroCopyPending_.front()))
+    {
+        zeroCopyPending_.pop_front();
+    }
+    zeroCopyPending_.erase(std::remove_if(zeroCopyPending_.begin(), zeroCopyPending_.end(), done),
+                           zeroCopyPending_.end());
+}
+
+void ChainBuffer::takeZeroCopyPending(ChainBuffer &other)
+{
+    for(auto& pending: other.zeroCopyPending_)
+    {
+        zeroCopyPending_.push_back(std::move(pending));
+    }
+    other.zeroCopyPending_.clear();
+}
+
+void ChainBuffer::append(const char *data, size_t len)
+{
+    readable_ += len;
+    while(len > 0)
+    {
+        if(slabs_.empty() || slabs_.back().isFile() || slabs_.back().isShared() ||
+           slabs_.back().end == slabs_.back().capacity)
+        {
+            pushSlab();
+        }
+        Slab& back = slabs_.back();
+        size_t n = std::min(len, back.capacity - back.end);
+        ::memcpy(back.data + back.end, data, n);
+        back.end += n;
+        data += n;
+        len -= n;
+    }
+}
+
+void ChainBuffer::retrieve(size_t len)
+{
+    assert(len <= readable_);
+    readable_ -= len;
+    while(len > 0)
+    {
+        Slab& front = slabs_.front();
+        size_t n = std::min(len, front.end - front.begin);
+        front.begin += n;
+        len -= n;
+        if(front.isFile())
+        {
+            fileBytes_ -= n;
+        }
+        // 读完的数据块直接释放；最后一个数据块还有可写空间时保留，以便继续追加
+        if(front.begin == front.end &&
+           (slabs_.size() > 1 || front.isFile() || front.isShared() || front.end == front.capacity))
+        {
+            popSlab();
+        }
+    }
+    if(readable_ == 0)
+    {
+        retrieveAll();
+    }
+}
+
+void ChainBuffer::retrieveAll()
+{
+    while(!slabs_.empty())
+    {
+        popSlab();
+    }
+    readable_ = 0;
+    fileBytes_ = 0;
+}
+
+void ChainBuffer::detachPool()
+{
+    retrieveAll();
+    pool_ = nullptr;
+}
+
+std::string ChainBuffer::retrieveAllAsString()
+{
+    std::string result;
+    result.reserve(readable_);
+    for(const Slab& slab: slabs_)
+    {
+        if(slab.isFile())
+        {
+            size_t begin = result.size();
+            result.resize(begin + slab.end - slab.begin);
+            ssize_t n = ::pread(slab.fileFd, &result[begin], slab.end - slab.begin,
+                                static_cast<off_t>(slab.begin));
+            result.resize(begin + (n > 0 ? n : 0));
+        }
+        else
+        {
+            result.append(slab.data + slab.begin, slab.end - slab.begin);
+        }
+    }
+    retrieveAll();
+    return result;
+}
+
+ssize_t ChainBuffer::writeFd(int fd, int *savedErrno)
+{
+    ssize_t n = 0;
+    if(!slabs_.empty() && slabs_.front().isFile())
+    {
+        Slab& front = slabs_.front();
+        off_t offset = static_cast<off_t>(front.begin);
+        n = ::sendfile(fd, front.fileFd, &offset, front.end - front.begin);
+        if(n == 0)
+        {
+            // 文件比排入时短（被截断），丢弃该文件段剩余的部分并继续输出后面的数据
+            retrieve(front.end - front.begin);
+            return readable_ > 0 ? writeFd(fd, savedErrno) : 0;
+        }
+    }
+    else if(!slabs_.empty() && useZeroCopy(slabs_.front()))
+    {
+        n = writeZeroCopy(fd, savedErrno);
+        if(n >= 0 || *savedErrno != ENOBUFS)
+        {
+            return n;
+        }
+        // 超出了锁定内存的限制(optmem_max)，本次按普通方式发送
+        n = ::write(fd, slabs_.front().data + slabs_.front().begin,
+                    slabs_.front().end - slabs_.front().begin);
+    }
+    else
+    {
+        struct iovec vec[IOV_MAX];
+        int vecNum = 0;
+        auto it = slabs_.begin();
+        for(; it != slabs_.end() && !it->isFile() && !useZeroCopy(*it) && vecNum < IOV_MAX; ++it)
+        {
+            if(it->end > it->begin)
+            {
+                vec[vecNum].iov_base = it->data + it->begin;
+                vec[vecNum].iov_len = it->end - it->begin;
+                ++vecNum;
+            }
+        }
+        n = -1;
+        if(it != slabs_.end() && vecNum < IOV_MAX)
+        {
+            // 后面紧接着文件段或零拷贝段（例如响应头之后的文件内容），
+            // 通过MSG_MORE让内核把这部分与接下来的数据合并成完整的报文段
+            struct msghdr msg;
+            ::memset(&msg, 0, sizeof msg);
+            msg.msg_iov = vec;
+            msg.msg_iovlen = vecNum;
+            n = ::sendmsg(fd, &msg, MSG_MORE);
+        }
+        if(n < 0 && (it == slabs_.end() || vecNum == IOV_MAX || errno == ENOTSOCK))
+        {
+            n = ::writev(fd, vec, vecNum);
+        }
+    }
+    if(n < 0)
+    {
+        *savedErrno = errno;
+    }
+    else
+    {
+        retrieve(n);
+    }
+    return n;
+}
+
+ssize_t ChainBuffer::writeZeroCopy(int fd, int *savedErrno)
+{
+    Slab& front = slabs_.front();
+    struct iovec vec;
+    vec.iov_base = front.data + front.begin;
+    vec.iov_len = front.end - front.begin;
+    struct msghdr msg;
+    ::memset(&msg, 0, sizeof msg);
+    msg.msg_iov = &vec;
+    msg.msg_iovlen = 1;
+    ssize_t n = ::sendmsg(fd, &msg, MSG_ZEROCOPY);
+    if(n < 0)
+    {
+        *savedErrno = errno;
+        return n;
+    }
+    // 每次成功的调用对应一个编号，内核完成之前必须保留数据
+    zeroCopyPending_.emplace_back(zeroCopySeq_++, front.owner);
+    retrieve(n);
+    return n;
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "base/BufferPool.h"
+#include "base/noncopyable.h"
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <utility>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/// @brief 由固定大小的数据块组成的输出缓冲区，用作TcpConnection的outputBuffer。
+/// 与Buffer不同，追加数据时只会在末尾写入或分配新的数据块，已有数据不会被移动或重新分配，
+/// 适合在慢速连接上积压大量待发送数据的场景。输出时通过一次writev(2)写出最多IOV_MAX个数据块。
+/// 缓冲区中还可以排入文件段（appendFile），按顺序通过sendfile(2)直接从文件输出，不经过用户态；
+/// 以及共享段（appendShared），只保存对不可变数据的引用，不复制数据。
+/// 设置了零拷贝阈值时，不小于阈值的共享段通过MSG_ZEROCOPY发送，
+/// 数据的引用一直保留到内核在错误队列上报告完成（handleZeroCopyCompletion）。
+///
+/// @code
+///   front                                   back
+/// +-------+--------------+   +-------------+   +--------------+------------+
+/// | sent  |   readable   |-->|  readable   |-->|   readable   |  writable  |
+/// +-------+--------------+   +-------------+   +--------------+------------+
+///         begin        end                                   end     capacity
+/// @endcode
+class ChainBuffer: noncopyable
+{
+public:
+    static const size_t kSlabSize = 16 * 1024;
+
+    /// @param pool 数据块所属的内存池（一般是连接所在loop的池），为nullptr时直接使用堆
+    explicit ChainBuffer(BufferPool* pool = nullptr);
+    ~ChainBuffer();
+
+    size_t readableBytes() const { return readable_; }
+    /// @brief 占用内存的待发送字节数，不包括文件段（共享段的数据在发送完之前也被保留，计算在内）
+    size_t bufferedBytes() const { return readable_ - fileBytes_; }
+    /// @brief 数据块与文件段的个数
+    size_t numSlabs() const { return slabs_.size(); }
+
+    void append(const char* /*restrict*/ data, size_t len);
+    void append(const void* /*restrict*/ data, size_t len)
+    {
+        append(static_cast<const char*>(data), len);
+    }
+    void append(const std::string& str)
+    {
+        append(str.data(), str.size());
+    }
+
+    /// @brief 在末尾排入文件fd中[offset, offset + length)的内容，缓冲区获得fd的所有权，
+    /// 输出完毕或被丢弃时关闭fd
+    void appendFile(int fd, off_t offset, size_t length);
+
+    /// @brief 在末尾排入owner持有的[data, data + len)，输出完毕前缓冲区保留owner的引用。
+    /// 数据在此期间不能被修改
+    void appendShared(std::shared_ptr<const void> owner, const void* data, size_t len);
+
+    /// @brief 不小于threshold字节的共享段使用MSG_ZEROCOPY发送，0表示不使用。
+    /// 需要先在socket上开启SO_ZEROCOPY
+    void setZeroCopyThreshold(size_t threshold) { zeroCopyThreshold_ = threshold; }
+    size_t zeroCopyThreshold() const { return zeroCopyThreshold_; }
+    /// @brief 内核报告编号在[lo, hi]内的零拷贝发送已经完成，释放对应数据的引用
+    void handleZeroCopyCompletion(uint32_t lo, uint32_t hi);
+    /// @brief 已经发送但内核尚未报告完成的零拷贝发送数
+    size_t pendingZeroCopySends() const { return zeroCopyPending_.size(); }
+    /// @brief 接管other中等待完成通知的零拷贝发送及其数据的引用。
+    /// other被销毁时内核可能仍在发送这些数据，由本缓冲区保留到完成通知到达
+    void takeZeroCopyPending(ChainBuffer& other);
+
+    /// @brief 丢弃开头的len字节，释放已经读完的数据块
+    void retrieve(size_t len);
+    void retrieveAll();
+    /// @brief 丢弃数据并不再使用内存池，之后的数据块直接从堆上分配。
+    /// 缓冲区可能比池（所属的loop）存活得更久时，在池销毁前调用
+    void detachPool();
+    /// @brief 复制出全部数据（用于测试与调试），文件段通过pread读取
+    std::string retrieveAllAsString();
+
+    /// @brief 将缓冲区数据输出到fd中。开头是文件段时调用一次sendfile(2)，
+    /// 开头是达到零拷贝阈值的共享段时调用一次sendmsg(MSG_ZEROCOPY)，
+    /// 否则通过writev(2)一次写出下一个文件段或零拷贝共享段之前最多IOV_MAX个数据块
+    /// （后面还有文件段或零拷贝段时使用带MSG_MORE的sendmsg，fd不是socket时退回writev）
+    ssize_t writeFd(int fd, int* savedErrno);
+
+private:
+    /// 数据块、文件段或共享段。文件段的data为nullptr，begin/end是文件中的偏移；
+    /// 共享段的data指向owner持有的数据，不可写入
+    struct Slab
+    {
+        char* data;
+        size_t capacity;
+        size_t begin;   /* 第一个未读字节 */
+        size_t end;     /* 最后一个已写字节之后 */
+        int fileFd;     /* 文件段的fd，其他为-1 */
+        std::shared_ptr<const void> owner;  /* 共享段的数据所有者 */
+
+        bool isFile() const { return data == nullptr; }
+        bool isShared() const { return owner != nullptr; }
+    };
+
+    /// @brief 在末尾添加一个空的数据块
+    void pushSlab();
+    /// @brief 释放开头的数据块，或关闭开头文件段的fd
+    void popSlab();
+    /// @brief 通过sendmsg(MSG_ZEROCOPY)输出开头的共享段
+    ssize_t writeZeroCopy(int fd, int* savedErrno);
+    bool useZeroCopy(const Slab& slab) const
+    {
+        return zeroCopyThreshold_ > 0 && slab.isShared() && slab.end - slab.begin >= zeroCopyThreshold_;
+    }
+
+    BufferPool* pool_;
+    std::deque<Slab> slabs_;
+    size_t readable_;
+    size_t fileBytes_;  /* readable_中属于文件段的字节数 */
+    size_t zeroCopyThreshold_;
+    uint32_t zeroCopySeq_;  /* 下一次零拷贝发送的编号，与内核的计数一致 */
+    /// 已发送、等待完成通知的零拷贝发送编号及其数据
+    std::deque<std::pair<uint32_t, std::shared_ptr<const void>>> zeroCopyPending_;
+};
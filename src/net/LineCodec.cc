@@ -0,0 +1,82 @@
+#include "logger/Logging.h"
+#include "net/Buffer.h"
+#include "net/LineCodec.h"
+#include "net/TcpConnection.h"
+
+#include <assert.h>
+#include <string.h>
+
+LineCodec::LineCodec(const LineCallback &cb, size_t maxLineLength, const std::string &delimiter):
+    lineCallback_(cb),
+    maxLineLength_(maxLineLength),
+    delimiter_(delimiter)
+{
+    assert(!delimiter_.empty());
+}
+
+void LineCodec::onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime)
+{
+    const char* start = buf->peek();
+    while(true)
+    {
+        const char* delim = findDelimiter(buf, start);
+        size_t len = (delim ? delim : buf->beginWrite()) - start;
+        if(len > maxLineLength_)
+        {
+            buf->retrieveAll();
+            if(overflowCallback_)
+            {
+                overflowCallback_(conn, len);
+            }
+            else
+            {
+                LOG_ERROR << "LineCodec::onMessage [" << conn->name()
+                          << "] - line length " << len << " exceeds " << maxLineLength_;
+                conn->shutdown();
+            }
+            return;
+        }
+        if(delim == nullptr)
+        {
+            break;
+        }
+        lineCallback_(conn, StringPiece(start, len), receiveTime);
+        start = delim + delimiter_.size();
+    }
+    buf->retrieve(start - buf->peek());
+}
+
+void LineCodec::send(const TcpConnectionPtr &conn, StringPiece line) const
+{
+    std::string message;
+    message.reserve(line.size() + delimiter_.size());
+    message.append(line.data(), line.size());
+    message.append(delimiter_);
+    conn->send(std::move(message));
+}
+
+const char *LineCodec::findDelimiter(const Buffer *buf, const char *start) const
+{
+    if(delimiter_.size() == 1)
+    {
+        return buf->findByte(delimiter_[0], start);
+    }
+    if(delimiter_ == "\r\n")
+    {
+        return buf->findCRLF(start);
+    }
+    // 一般的多字节分隔符：先查找第一个字节，再比较其余部分
+    const char* end = buf->beginWrite();
+    for(const char* p = start; (p = buf->findByte(delimiter_[0], p)) != nullptr; ++p)
+    {
+        if(static_cast<size_t>(end - p) < delimiter_.size())
+        {
+            return nullptr;
+        }
+        if(::memcmp(p + 1, delimiter_.data() + 1, delimiter_.size() - 1) == 0)
+        {
+            return p;
+        }
+    }
+    return nullptr;
+}
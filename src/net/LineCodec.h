@@ -0,0 +1,53 @@
+#pragma once
+
+#include "base/Callback.h"
+#include "base/noncopyable.h"
+#include "base/StringPiece.h"
+#include "base/Timestamp.h"
+
+#include <string>
+
+/// @brief 按分隔符切分消息的编解码器，用于Redis/HTTP一类的文本协议。
+/// 作为连接的messageCallback使用：每收到一行完整的数据就调用一次lineCallback，
+/// 行以StringPiece的形式直接指向输入缓冲区（不含分隔符），不复制数据，只在回调期间有效。
+/// 所有完整的行处理完后才一次性从缓冲区中丢弃。
+/// 一行（或尚未收到分隔符的数据）超过maxLineLength时调用overflowCallback并丢弃缓冲区中的数据，
+/// 默认的处理是记录错误并关闭连接的写端。
+///
+/// @code
+///   LineCodec codec(onLine);
+///   server.setMessageCallback(std::bind(&LineCodec::onMessage, &codec, _1, _2, _3));
+/// @endcode
+class LineCodec: noncopyable
+{
+public:
+    using LineCallback = std::function<void(const TcpConnectionPtr&, StringPiece, Timestamp)>;
+    using OverflowCallback = std::function<void(const TcpConnectionPtr&, size_t)>;
+
+    static const size_t kDefaultMaxLineLength = 64 * 1024;
+
+    /// @param delimiter 行分隔符，"\r\n"与单字节分隔符使用专门的查找实现
+    explicit LineCodec(const LineCallback& cb,
+                       size_t maxLineLength = kDefaultMaxLineLength,
+                       const std::string& delimiter = "\r\n");
+
+    /// @brief 行过长时的处理，参数为已经积累的字节数
+    void setOverflowCallback(const OverflowCallback& cb) { overflowCallback_ = cb; }
+
+    const std::string& delimiter() const { return delimiter_; }
+    size_t maxLineLength() const { return maxLineLength_; }
+
+    void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp receiveTime);
+
+    /// @brief 发送一行数据，自动追加分隔符
+    void send(const TcpConnectionPtr& conn, StringPiece line) const;
+
+private:
+    /// @brief 从start开始查找分隔符
+    const char* findDelimiter(const Buffer* buf, const char* start) const;
+
+    LineCallback lineCallback_;
+    OverflowCallback overflowCallback_;
+    const size_t maxLineLength_;
+    const std::string delimiter_;
+};
@@ -0,0 +1,37 @@
+#include "event/EventLoop.h"
+#include "net/LoopGroup.h"
+#include "net/TcpConnection.h"
+
+#include <memory>
+#include <unordered_map>
+
+void forEachLoopGroup(const std::vector<TcpConnectionPtr> &conns,
+                      const std::function<void(const TcpConnectionPtr&)> &fn,
+                      bool queue)
+{
+    std::unordered_map<EventLoop*, std::vector<TcpConnectionPtr>> byLoop;
+    for(const TcpConnectionPtr& conn: conns)
+    {
+        byLoop[conn->getLoop()].push_back(conn);
+    }
+    for(auto& item: byLoop)
+    {
+        std::shared_ptr<std::vector<TcpConnectionPtr>> group(
+            std::make_shared<std::vector<TcpConnectionPtr>>(std::move(item.second)));
+        auto task = [group, fn]()
+        {
+            for(const TcpConnectionPtr& conn: *group)
+            {
+                fn(conn);
+            }
+        };
+        if(queue)
+        {
+            item.first->queueInLoop(task);
+        }
+        else
+        {
+            item.first->runInLoop(task);
+        }
+    }
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "base/Callback.h"
+
+#include <vector>
+
+/// @brief 把conns按所属的loop分组（组内保持conns中的顺序），每个loop只投递一个任务，
+/// 在该loop中依次对本组的连接调用fn。连接很多时每个loop每批只被唤醒一次。
+/// @param queue 为true时总是通过queueInLoop投递，即使调用者就在该loop线程中，
+/// 避免fn在调用者的调用栈中执行；为false时通过runInLoop投递
+void forEachLoopGroup(const std::vector<TcpConnectionPtr>& conns,
+                      const std::function<void(const TcpConnectionPtr&)>& fn,
+                      bool queue = false);
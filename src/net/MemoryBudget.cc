@@ -0,0 +1,92 @@
+#include "net/LoopGroup.h"
+#include "net/MemoryBudget.h"
+#include "net/TcpConnection.h"
+
+#include <algorithm>
+#include <assert.h>
+
+MemoryBudget::MemoryBudget():
+    usage_(0),
+    overloaded_(false),
+    limit_(0),
+    resume_(0)
+{
+}
+
+void MemoryBudget::setLimit(size_t limit, size_t resume)
+{
+    assert(limit == 0 || resume < limit);
+    limit_ = limit;
+    resume_ = resume;
+}
+
+void MemoryBudget::update(int64_t delta)
+{
+    int64_t usage = usage_.fetch_add(delta) + delta;
+    // 只有用量减少时才可能回落到resume以下
+    if(delta >= 0 || usage >= static_cast<int64_t>(resume_) || !overloaded_.load())
+    {
+        return;
+    }
+    std::vector<std::weak_ptr<TcpConnection>> paused;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(!overloaded_.load())
+        {
+            return;
+        }
+        overloaded_.store(false);
+        paused.swap(paused_);
+    }
+    resumeAll(std::move(paused));
+}
+
+bool MemoryBudget::tryPause(TcpConnection* conn)
+{
+    if(limit_ == 0)
+    {
+        return false;
+    }
+    int64_t threshold = static_cast<int64_t>(limit_) +
+                        static_cast<int64_t>(conn->readPriority()) * static_cast<int64_t>(limit_ - resume_);
+    if(usage_.load() <= threshold)
+    {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    // 先登记并标记，再重新检查用量。用量在标记之后回落时，update一定能看到标记，
+    // 在锁释放后恢复该连接；用量在标记之前已经回落时，重新检查一定能看到，撤销登记与标记
+    paused_.push_back(conn->shared_from_this());
+    overloaded_.store(true);
+    if(usage_.load() <= threshold)
+    {
+        paused_.pop_back();
+        overloaded_.store(!paused_.empty());
+        return false;
+    }
+    return true;
+}
+
+void MemoryBudget::resumeAll(std::vector<std::weak_ptr<TcpConnection>> paused)
+{
+    std::vector<TcpConnectionPtr> conns;
+    conns.reserve(paused.size());
+    for(const std::weak_ptr<TcpConnection>& weak: paused)
+    {
+        TcpConnectionPtr conn(weak.lock());
+        if(conn)
+        {
+            conns.push_back(std::move(conn));
+        }
+    }
+    // 分组保持顺序，每个loop中按优先级从高到低恢复
+    std::stable_sort(conns.begin(), conns.end(), [](const TcpConnectionPtr& a, const TcpConnectionPtr& b)
+    {
+        return a->readPriority() > b->readPriority();
+    });
+    // update可能在某个连接的回调中被调用，恢复读取总是留到loop处理完当前事件后
+    forEachLoopGroup(conns, [](const TcpConnectionPtr& conn)
+    {
+        conn->resumeReadAfterMemoryBudget();
+    }, true);
+}
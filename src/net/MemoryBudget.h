@@ -0,0 +1,52 @@
+#pragma once
+
+#include "base/noncopyable.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+class TcpConnection;
+
+/// @brief 一组连接（一个TcpServer的全部连接）输入输出缓冲区的内存统计与全局预算。
+/// 各连接在自己的loop线程中报告缓冲字节数的变化，用量是所有loop共享的一个原子计数。
+///
+/// 设置了上限后，用量超过上限时连接在读取后停止读取（stopRead），按读取优先级分级：
+/// 优先级为p的连接在用量超过 limit + p * (limit - resume) 时暂停，
+/// 即低优先级的连接先暂停，只有用量继续增长时才暂停更高优先级的连接。
+/// 用量回落到resume以下时，向每个相关的loop投递一个任务，按优先级从高到低恢复读取
+class MemoryBudget: noncopyable
+{
+public:
+    MemoryBudget();
+
+    /// @brief limit为0表示不限制，只统计用量。需要在连接建立前设置
+    void setLimit(size_t limit, size_t resume);
+    size_t limit() const { return limit_; }
+    size_t resume() const { return resume_; }
+
+    /// @brief 当前所有连接缓冲区的字节数
+    int64_t usage() const { return usage_.load(std::memory_order_relaxed); }
+    /// @brief 是否有连接因为超出预算而暂停读取
+    bool overloaded() const { return overloaded_.load(); }
+
+    /// @brief 连接的缓冲字节数变化了delta，回落到resume以下时恢复暂停的连接。线程安全
+    void update(int64_t delta);
+    /// @brief 连接读取数据后调用。超出该连接优先级的阈值时登记该连接并返回true，
+    /// 调用者随后在同一个loop线程中停止读取。线程安全
+    bool tryPause(TcpConnection* conn);
+
+private:
+    /// @brief 恢复所有登记的连接，每个loop一个任务
+    void resumeAll(std::vector<std::weak_ptr<TcpConnection>> paused);
+
+    std::atomic<int64_t> usage_;
+    std::atomic<bool> overloaded_;  /* 在mutex_中修改，与paused_是否为空一致 */
+    size_t limit_;
+    size_t resume_;
+    std::mutex mutex_;
+    std::vector<std::weak_ptr<TcpConnection>> paused_;
+};
@@ -2,9 +2,11 @@
 #include "net/Socket.h"
 #include "net/InetAddress.h"
 
+#include <errno.h>
 #include <unistd.h>
 // #include <sys/socket.h>
 #include <netinet/tcp.h>
+#include <linux/errqueue.h>
 #include "Socket.h"
 
 namespace Utils
@@ -94,8 +96,25 @@ int Socket::accept(InetAddress *peeraddr)
     else
     {
         int savedErrno = errno;
-        LOG_ERROR << "Socket::accept";
-        LOG_FATAL << "unexpected error of ::accept " << savedErrno;
+        switch (savedErrno)
+        {
+            case EAGAIN:
+            case ECONNABORTED:
+            case EINTR:
+            case EPROTO:
+            case EPERM:
+            case EMFILE:
+            case ENFILE:
+            case ENOBUFS:
+            case ENOMEM:
+                // 可恢复的错误, 由调用者根据errno处理
+                break;
+            default:
+                LOG_ERROR << "Socket::accept";
+                LOG_FATAL << "unexpected error of ::accept " << savedErrno;
+                break;
+        }
+        errno = savedErrno;
     }
     return connfd;
 }
@@ -152,6 +171,62 @@ void Socket::setKeepAlive(bool on)
     }
 }
 
+void Socket::setBusyPoll(int usec)
+{
+    int optval = usec;
+    int ret = ::setsockopt(sockfd_, SOL_SOCKET, SO_BUSY_POLL,
+                &optval, static_cast<socklen_t>(sizeof optval));
+    if (ret < 0)
+    {
+        LOG_ERROR << "SO_BUSY_POLL failed.";
+    }
+}
+
+bool Socket::setZeroCopy(bool on)
+{
+    int optval = on ? 1 : 0;
+    int ret = ::setsockopt(sockfd_, SOL_SOCKET, SO_ZEROCOPY,
+                &optval, static_cast<socklen_t>(sizeof optval));
+    if (ret < 0 && on)
+    {
+        LOG_ERROR << "SO_ZEROCOPY failed.";
+    }
+    return ret == 0;
+}
+
+int Socket::readZeroCopyCompletion(uint32_t *lo, uint32_t *hi, bool *copied)
+{
+    char control[128];
+    struct msghdr msg;
+    // 错误队列中不是零拷贝完成通知的消息（例如ICMP错误）被丢弃
+    while (true)
+    {
+        memset(&msg, 0, sizeof msg);
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof control;
+        if (::recvmsg(sockfd_, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+        {
+            return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+        }
+        for (struct cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm != nullptr; cm = CMSG_NXTHDR(&msg, cm))
+        {
+            if ((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
+                (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR))
+            {
+                struct sock_extended_err err;
+                memcpy(&err, CMSG_DATA(cm), sizeof err);
+                if (err.ee_origin == SO_EE_ORIGIN_ZEROCOPY && err.ee_errno == 0)
+                {
+                    *lo = err.ee_info;
+                    *hi = err.ee_data;
+                    *copied = (err.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0;
+                    return 1;
+                }
+            }
+        }
+    }
+}
+
 int Socket::createNoblockingOrDie(int domain)
 {
     int sockfd = ::socket(domain, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
@@ -2,6 +2,8 @@
 
 #include "base/noncopyable.h"
 
+#include <stdint.h>
+
 struct sockaddr_in;
 class InetAddress;
 
@@ -33,7 +35,9 @@ public:
     
     /// @brief 接受连接
     /// @param peeraddr 如果成功，则peeraddr被赋值
-    /// @return 如果成功，返回接受的socket的描述符（一个非负数），否则返回-1
+    /// @return 如果成功，返回接受的socket的描述符（一个非负数），否则返回-1并保留errno。
+    /// 没有待接受的连接(EAGAIN)、对端已放弃连接、描述符耗尽等可恢复的错误由调用者处理，
+    /// 只有监听socket本身无效时中止
     int accept(InetAddress* peeraddr);
 
     // 设置半关闭
@@ -51,6 +55,20 @@ public:
     // 设置长连接
     void setKeepAlive(bool on);     
 
+    /// @brief 设置SO_BUSY_POLL，阻塞读或poll时在网卡队列上忙等usec微秒
+    /// @note 超过net.core.busy_read的取值需要CAP_NET_ADMIN权限，失败时只记录错误
+    void setBusyPoll(int usec);
+
+    /// @brief 设置SO_ZEROCOPY，之后才能使用MSG_ZEROCOPY发送
+    /// @return 是否设置成功（内核不支持时失败）
+    bool setZeroCopy(bool on);
+
+    /// @brief 从错误队列读取一条MSG_ZEROCOPY的完成通知
+    /// @param lo,hi 已完成发送的编号范围[lo, hi]
+    /// @param copied 内核是否退化为复制了数据（例如发往本机的连接）
+    /// @return 读到通知返回1，队列中没有通知返回0，其他错误返回-1
+    int readZeroCopyCompletion(uint32_t* lo, uint32_t* hi, bool* copied);
+
     static int createNoblockingOrDie(int domain);
 
 private:
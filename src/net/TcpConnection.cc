@@ -1,36 +1,122 @@
 #include "event/Channel.h"
 #include "event/EventLoop.h"
 #include "logger/Logging.h"
+#include "net/MemoryBudget.h"
 #include "net/TcpConnection.h"
 #include "net/Socket.h"
 
+#include <algorithm>
 #include <functional>
+#include <vector>
 #include <assert.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <unistd.h>
 
+namespace
+{
+/// 连接销毁后仍在等待完成通知的零拷贝发送。内核在通知之前一直从数据所在的页中发送，
+/// 保留数据的引用与socket（dup的fd，关闭连接的fd后错误队列仍然存在），直到全部完成
+struct ZeroCopyDrain
+{
+    std::unique_ptr<Socket> socket;
+    ChainBuffer pending;
+};
+
+const double kZeroCopyDrainMaxInterval = 1.0;
+
+/// @brief 取走message的存储空间，message换成同一内存池中初始大小的空缓冲区。
+/// send(buf)传入的常常是连接自己的inputBuffer_，之后它仍然从loop的池中分配
+std::shared_ptr<Buffer> takeStorage(Buffer& message)
+{
+    std::shared_ptr<Buffer> owner(std::make_shared<Buffer>(Buffer::kInitialSize, message.pool()));
+    owner->swap(message);
+    return owner;
+}
+
+/// @brief 读取错误队列，仍有未完成的发送时在interval秒后再次检查（间隔逐次加倍）。
+/// 全部完成后drain被释放，数据的引用随之释放、fd被关闭
+void drainZeroCopy(EventLoop* loop, const std::shared_ptr<ZeroCopyDrain>& drain, double interval)
+{
+    uint32_t lo = 0;
+    uint32_t hi = 0;
+    bool copied = false;
+    while(drain->socket->readZeroCopyCompletion(&lo, &hi, &copied) > 0)
+    {
+        drain->pending.handleZeroCopyCompletion(lo, hi);
+    }
+    if(drain->pending.pendingZeroCopySends() == 0)
+    {
+        return;
+    }
+    loop->runAfter(interval, std::bind(drainZeroCopy, loop, drain,
+                                       std::min(interval * 2, kZeroCopyDrainMaxInterval)));
+}
+}
+
+TcpConnection::TcpConnection(EventLoop *loop, uint64_t id, std::shared_ptr<const std::string> namePrefix, int sockfd, const InetAddress &localAddr, const InetAddress &peerAddr):
+    TcpConnection(loop, id, std::move(namePrefix), std::string(), sockfd, localAddr, peerAddr)
+{
+}
 
 TcpConnection::TcpConnection(EventLoop *loop, const std::string &name, int sockfd, const InetAddress &localAddr, const InetAddress &peerAddr):
+    TcpConnection(loop, 0, nullptr, name, sockfd, localAddr, peerAddr)
+{
+}
+
+TcpConnection::TcpConnection(EventLoop *loop, uint64_t id, std::shared_ptr<const std::string> namePrefix, std::string name, int sockfd, const InetAddress &localAddr, const InetAddress &peerAddr):
     loop_(loop),
-    name_(name),
+    id_(id),
+    namePrefix_(std::move(namePrefix)),
+    name_(std::move(name)),
     state_(kConnecting),
     reading_(false),
     socket_(new Socket(sockfd)),
     channel_(new Channel(loop_, sockfd)),
     localAddr_(localAddr),
     peerAddr_(peerAddr),
-    highWaterMark_(64*1024*1024)
+    highWaterMark_(64*1024*1024),
+    drainBudget_(kDefaultDrainBudget),
+    queryReadSize_(false),
+    inputBuffer_(Buffer::kInitialSize, loop->bufferPool()),
+    outputBuffer_(loop->bufferPool()),
+    zeroCopyCompleted_(0),
+    zeroCopyCopied_(0),
+    accountedBytes_(0),
+    readPriority_(0),
+    readPaused_(0),
+    backpressureHigh_(0),
+    backpressureLow_(0),
+    hasBackpressurePartner_(false),
+    backpressureActive_(false),
+    backpressureSources_(0),
+    coalesceWrites_(false),
+    corked_(false),
+    flushScheduled_(false)
 {
     channel_->setReadCallback(std::bind(&TcpConnection::handleRead, this, std::placeholders::_1));
     channel_->setWriteCallback(std::bind(&TcpConnection::handleWrite, this));
     channel_->setErrorCallback(std::bind(&TcpConnection::handleError, this));
     channel_->setCloseCallback(std::bind(&TcpConnection::handleClose, this));
 
-    LOG_INFO << "TcpConnection::ctor[" << name_.c_str() << "] at fd =" << sockfd;
+    LOG_INFO << "TcpConnection::ctor[" << this->name() << "] at fd =" << sockfd;
     socket_->setKeepAlive(true);
 }
 
 TcpConnection::~TcpConnection()
 {
-    LOG_INFO << "TcpConnection::dtor[" << name_.c_str() << "] at fd=" << channel_->fd() << " state=" << static_cast<int>(state_);
+    LOG_INFO << "TcpConnection::dtor[" << name() << "] at fd=" << channel_->fd() << " state=" << static_cast<int>(state_);
+}
+
+const std::string& TcpConnection::name() const
+{
+    if(namePrefix_)
+    {
+        std::call_once(nameOnce_, [this]() { name_ = *namePrefix_ + std::to_string(id_); });
+    }
+    return name_;
 }
 
 std::string TcpConnection::getTcpInfoString() const
@@ -43,22 +129,170 @@ std::string TcpConnection::getTcpInfoString() const
 
 void TcpConnection::send(const void *message, int len)
 {
-    if(state_.load() == kConnected)
+    if(state_.load() != kConnected)
+    {
+        return;
+    }
+    if(loop_->isInLoopThread())
+    {
+        sendInLoop(message, len);
+    }
+    else
     {
-        loop_->runInLoop(
-            std::bind(&TcpConnection::sendInLoop, this, message, len));
+        // 调用者的内存在任务执行时可能已经失效，复制一份随任务转移
+        sendSharedInLoopQueued(std::make_shared<const std::string>(static_cast<const char*>(message), len));
     }
 }
 
 void TcpConnection::send(const std::string &message)
 {
-    send(message.c_str(), message.length());
+    send(message.data(), static_cast<int>(message.size()));
+}
+
+void TcpConnection::send(std::string &&message)
+{
+    if(state_.load() != kConnected)
+    {
+        return;
+    }
+    if(loop_->isInLoopThread())
+    {
+        ssize_t nWritten = writeDirectInLoop(message.data(), message.size());
+        if(nWritten < 0 || static_cast<size_t>(nWritten) == message.size())
+        {
+            return;
+        }
+        // 没有写完的部分连同字符串的所有权转入输出缓冲区，不复制。
+        // 短字符串移动时数据会被复制到新对象中，按偏移重新取地址
+        std::shared_ptr<const std::string> owner(std::make_shared<const std::string>(std::move(message)));
+        queueOutputInLoop(owner->data() + nWritten, owner->size() - nWritten, owner);
+    }
+    else
+    {
+        sendSharedInLoopQueued(std::make_shared<const std::string>(std::move(message)));
+    }
+}
+
+void TcpConnection::send(Buffer &&message)
+{
+    if(state_.load() != kConnected)
+    {
+        return;
+    }
+    if(loop_->isInLoopThread())
+    {
+        ssize_t nWritten = writeDirectInLoop(message.peek(), message.readableBytes());
+        if(nWritten < 0 || static_cast<size_t>(nWritten) == message.readableBytes())
+        {
+            message.retrieveAll();
+            return;
+        }
+        // 没有写完的部分连同存储空间转入输出缓冲区
+        message.retrieve(nWritten);
+        std::shared_ptr<Buffer> owner(takeStorage(message));
+        queueOutputInLoop(owner->peek(), owner->readableBytes(), owner);
+    }
+    else
+    {
+        std::shared_ptr<Buffer> buffer(takeStorage(message));
+        TcpConnectionPtr guard(shared_from_this());
+        loop_->queueInLoop([guard, buffer]()
+        {
+            struct iovec vec;
+            vec.iov_base = const_cast<char*>(buffer->peek());
+            vec.iov_len = buffer->readableBytes();
+            guard->sendvInLoop(&vec, 1, buffer);
+        });
+    }
+}
+
+void TcpConnection::send(const struct iovec *iov, int iovcnt, std::shared_ptr<const void> owner)
+{
+    if(state_.load() != kConnected)
+    {
+        return;
+    }
+    if(loop_->isInLoopThread())
+    {
+        sendvInLoop(iov, iovcnt, owner);
+    }
+    else if(owner)
+    {
+        std::shared_ptr<std::vector<struct iovec>> vec(
+            std::make_shared<std::vector<struct iovec>>(iov, iov + iovcnt));
+        TcpConnectionPtr guard(shared_from_this());
+        loop_->queueInLoop([guard, vec, owner]()
+        {
+            guard->sendvInLoop(vec->data(), static_cast<int>(vec->size()), owner);
+        });
+    }
+    else
+    {
+        std::string message;
+        for(int i = 0; i < iovcnt; i++)
+        {
+            message.append(static_cast<const char*>(iov[i].iov_base), iov[i].iov_len);
+        }
+        sendSharedInLoopQueued(std::make_shared<const std::string>(std::move(message)));
+    }
+}
+
+void TcpConnection::sendFile(int fd, off_t offset, size_t length)
+{
+    if(state_.load() != kConnected)
+    {
+        return;
+    }
+    int dupFd = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if(dupFd < 0)
+    {
+        LOG_ERROR << "TcpConnection::sendFile - dup " << fd;
+        return;
+    }
+    if(loop_->isInLoopThread())
+    {
+        sendFileInLoop(dupFd, offset, length);
+    }
+    else
+    {
+        loop_->queueInLoop(
+            std::bind(&TcpConnection::sendFileInLoop, shared_from_this(), dupFd, offset, length));
+    }
 }
 
-void TcpConnection::send(Buffer *message)
+void TcpConnection::sendShared(const std::shared_ptr<const std::string>& message)
 {
-    send(message->peek(), message->readableBytes());
-    message->retrieveAll();
+    if(state_.load() != kConnected)
+    {
+        return;
+    }
+    if(loop_->isInLoopThread())
+    {
+        sendSharedInLoop(message);
+    }
+    else
+    {
+        sendSharedInLoopQueued(message);
+    }
+}
+
+void TcpConnection::sendSharedInLoopQueued(const std::shared_ptr<const std::string>& message)
+{
+    loop_->queueInLoop(
+        std::bind(&TcpConnection::sendSharedInLoop, shared_from_this(), message));
+}
+
+void TcpConnection::setZeroCopyThreshold(size_t threshold)
+{
+    if(threshold > 0 && outputBuffer_.zeroCopyThreshold() == 0 && !socket_->setZeroCopy(true))
+    {
+        threshold = 0;
+    }
+    outputBuffer_.setZeroCopyThreshold(threshold);
+    if(threshold > 0)
+    {
+        channel_->setErrorQueueCallback(std::bind(&TcpConnection::handleErrorQueue, this));
+    }
 }
 
 void TcpConnection::shutdown()
@@ -70,7 +304,7 @@ void TcpConnection::shutdown()
     }
     else
     {
-        LOG_DEBUG << "fail at shuting down TcpConnection " << name_ << " with state" << stateToString(expect);
+        LOG_DEBUG << "fail at shuting down TcpConnection " << name() << " with state" << stateToString(expect);
     }
 }
 
@@ -84,7 +318,7 @@ void TcpConnection::forceClose()
     }
     else
     {
-        LOG_DEBUG << "fail at forcing close TcpConnection " << name_ << " with state" << stateToString(expect);
+        LOG_DEBUG << "fail at forcing close TcpConnection " << name() << " with state" << stateToString(expect);
     }
 }
 
@@ -98,7 +332,7 @@ void TcpConnection::forceCloseWithDelay(double seconds)
     }
     else
     {
-        LOG_DEBUG << "fail at forcing close TcpConnection " << name_ << " with state" << stateToString(expect);
+        LOG_DEBUG << "fail at forcing close TcpConnection " << name() << " with state" << stateToString(expect);
     }
 }
 
@@ -107,6 +341,64 @@ void TcpConnection::setTcpNoDelay(bool on)
     socket_->setTcpNoDelay(on);
 }
 
+void TcpConnection::setBackpressure(size_t highWaterMark, size_t lowWaterMark, const TcpConnectionPtr &partner)
+{
+    assert(highWaterMark == 0 || lowWaterMark < highWaterMark);
+    if(backpressureActive_)
+    {
+        // 先恢复原来的目标，再按新的设置检查
+        backpressureActive_ = false;
+        setBackpressureTarget(false);
+    }
+    backpressureHigh_ = highWaterMark;
+    backpressureLow_ = lowWaterMark;
+    backpressurePartner_ = partner;
+    hasBackpressurePartner_ = partner != nullptr;
+    if(highWaterMark > 0)
+    {
+        checkHighWaterMark(outputBuffer_.readableBytes());
+    }
+}
+
+void TcpConnection::setWriteCoalescing(bool on)
+{
+    coalesceWrites_ = on;
+    if(!on && outputBuffer_.readableBytes() > 0)
+    {
+        scheduleWrite();
+    }
+}
+
+void TcpConnection::cork()
+{
+    TcpConnectionPtr guard(shared_from_this());
+    loop_->runInLoop([guard]() { guard->corked_ = true; });
+}
+
+void TcpConnection::uncork()
+{
+    TcpConnectionPtr guard(shared_from_this());
+    loop_->runInLoop([guard]()
+    {
+        if(guard->corked_)
+        {
+            guard->corked_ = false;
+            guard->flushInLoop();
+        }
+    });
+}
+
+void TcpConnection::setEdgeTriggered(bool on, size_t drainBudget)
+{
+    drainBudget_ = drainBudget;
+    channel_->setEdgeTriggered(on);
+}
+
+bool TcpConnection::isEdgeTriggered() const
+{
+    return channel_->isEdgeTriggered();
+}
+
 void TcpConnection::startRead()
 {
     loop_->runInLoop(std::bind(&TcpConnection::startReadInLoop, this));
@@ -139,8 +431,14 @@ void TcpConnection::connectEstablished()
     Utils::assertInLoopThread(loop_);
     assert(state_.load() == kConnecting);
     state_.store(kConnected);
+    // 构造函数在base loop中执行，socketBusyPollUs只能在本loop线程中读取
+    if(loop_->socketBusyPollUs() > 0)
+    {
+        socket_->setBusyPoll(loop_->socketBusyPollUs());
+    }
     channel_->tie(shared_from_this());
     channel_->enableReading();
+    reading_ = true;
 
     connectionCallback_(shared_from_this());
 }
@@ -155,22 +453,90 @@ void TcpConnection::connectDestroyed()
         connectionCallback_(shared_from_this());
     }
     channel_->remove(); // 把channel从poller中删除掉
+    if(outputBuffer_.pendingZeroCopySends() > 0)
+    {
+        // 数据与socket的引用转交给drain，连接析构后保留到内核报告完成
+        int fd = ::fcntl(socket_->fd(), F_DUPFD_CLOEXEC, 0);
+        if(fd >= 0)
+        {
+            std::shared_ptr<ZeroCopyDrain> drain(std::make_shared<ZeroCopyDrain>());
+            drain->socket.reset(new Socket(fd));
+            // 连接的fd关闭后socket仍被drain打开，半关闭使对端照常收到FIN
+            drain->socket->shutdownWrite();
+            drain->pending.takeZeroCopyPending(outputBuffer_);
+            drainZeroCopy(loop_, drain, 0.001);
+        }
+        else
+        {
+            // 无法再得知发送何时完成，宁可泄漏数据也不能让内核发送被释放的内存
+            LOG_ERROR << "TcpConnection::connectDestroyed [" << name()
+                << "] - dup failed, leaking " << outputBuffer_.pendingZeroCopySends()
+                << " pending zero-copy sends";
+            (new ChainBuffer)->takeZeroCopyPending(outputBuffer_);
+        }
+    }
+    // 连接不再使用缓冲区，释放计入预算的字节。
+    // 用户持有的TcpConnectionPtr可能比loop存活得更久，缓冲区不再引用loop的内存池
+    inputBuffer_.detachPool();
+    outputBuffer_.detachPool();
+    updateMemoryUsage();
 }
 
 void TcpConnection::handleRead(Timestamp receiveTime)
 {
     Utils::assertInLoopThread(loop_);
     int savedErrno = 0;
-    ssize_t n = inputBuffer_.readFd(socket_->fd(), &savedErrno);
-    if(n > 0)
+    ssize_t total = 0;
+    ssize_t n = 0;
+    // 边缘触发模式下读取直到EAGAIN或达到上限
+    do
+    {
+        loop_->stats().countRead();
+        n = inputBuffer_.readFd(socket_->fd(), &savedErrno, queryReadSize_);
+        if(n > 0)
+        {
+            total += n;
+        }
+    } while(channel_->isEdgeTriggered() && n > 0 && static_cast<size_t>(total) < drainBudget_);
+
+    if(total > 0)
     {
         messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+        // 数据已处理完且socket中没有剩余数据时连接进入空闲，不论最后一次读取多大，
+        // 都把突发流量扩容的空间交还给内存池
+        if(inputBuffer_.readableBytes() == 0 &&
+           inputBuffer_.internalCapacity() > kIdleShrinkCapacity &&
+           inputDrained(n, savedErrno))
+        {
+            inputBuffer_.shrink(Buffer::kInitialSize);
+        }
+        updateMemoryUsage();
+        if(memoryBudget_ && reading_ && memoryBudget_->tryPause(this))
+        {
+            pauseReadInLoop(kPausedByMemoryBudget);
+        }
+        if(n > 0 && channel_->isEdgeTriggered())
+        {
+            // 未读到EAGAIN，不会再有新的通知，留到下一轮循环继续读取
+            TcpConnectionPtr guard(shared_from_this());
+            loop_->queueInLoop([guard, receiveTime]()
+            {
+                if(guard->connected() && guard->channel_->isReading())
+                {
+                    guard->handleRead(receiveTime);
+                }
+            });
+        }
     }
-    else if(n == 0)
+
+    if(n == 0)
     {
-        handleClose();
-    }   
-    else
+        if(!disconnected())
+        {
+            handleClose();
+        }
+    }
+    else if(n < 0 && !(savedErrno == EAGAIN && (total > 0 || channel_->isEdgeTriggered())))
     {
         errno = savedErrno;
         LOG_ERROR << "TcpConnection::handleRead";
@@ -178,15 +544,54 @@ void TcpConnection::handleRead(Timestamp receiveTime)
     }
 }
 
+bool TcpConnection::inputDrained(ssize_t lastRead, int savedErrno) const
+{
+    if(channel_->isEdgeTriggered())
+    {
+        return lastRead < 0 && savedErrno == EAGAIN;
+    }
+    // 水平触发模式每次事件只读一次，查询socket中是否还有数据
+    int available = 0;
+    return ::ioctl(socket_->fd(), FIONREAD, &available) == 0 && available == 0;
+}
+
 void TcpConnection::handleWrite()
 {
     Utils::assertInLoopThread(loop_);
     assert(channel_->isWriting());
     int savedErrno = 0;
-    ssize_t n = outputBuffer_.writeFd(socket_->fd(), &savedErrno);
-    if(n > 0)
+    ssize_t total = 0;
+    ssize_t n = 0;
+    // 边缘触发模式下写入直到EAGAIN、缓冲区为空或达到上限
+    do
+    {
+        loop_->stats().countWrite();
+        n = outputBuffer_.writeFd(socket_->fd(), &savedErrno);
+        if(n > 0)
+        {
+            total += n;
+        }
+    } while(channel_->isEdgeTriggered() && n > 0 &&
+            outputBuffer_.readableBytes() > 0 && static_cast<size_t>(total) < drainBudget_);
+    updateMemoryUsage();
+    checkLowWaterMark();
+
+    // 被截断的文件段会在没有写出数据的情况下被丢弃，此时缓冲区也可能已经为空
+    if(total > 0 || outputBuffer_.readableBytes() == 0)
     {
-        if(outputBuffer_.readableBytes() == 0)
+        if(outputBuffer_.readableBytes() > 0 && n > 0 && channel_->isEdgeTriggered())
+        {
+            // 未写到EAGAIN，不会再有新的通知，留到下一轮循环继续写入
+            TcpConnectionPtr guard(shared_from_this());
+            loop_->queueInLoop([guard]()
+            {
+                if(guard->channel_->isWriting())
+                {
+                    guard->handleWrite();
+                }
+            });
+        }
+        else if(outputBuffer_.readableBytes() == 0)
         {
             channel_->disableWriting();
             if(writeCompleteCallback_)
@@ -214,10 +619,34 @@ void TcpConnection::handleError()
     {
         err = errno;
     }
-    LOG_ERROR << "TcpConnection::handleError [" << name_
+    LOG_ERROR << "TcpConnection::handleError [" << name()
               << "] - SO_ERROR = " << err << " " << Utils::strerror_tl(err);
 }
 
+void TcpConnection::handleErrorQueue()
+{
+    Utils::assertInLoopThread(loop_);
+    uint32_t lo = 0;
+    uint32_t hi = 0;
+    bool copied = false;
+    int completions = 0;
+    int ret = 0;
+    while((ret = socket_->readZeroCopyCompletion(&lo, &hi, &copied)) > 0)
+    {
+        outputBuffer_.handleZeroCopyCompletion(lo, hi);
+        zeroCopyCompleted_ += hi - lo + 1;
+        if(copied)
+        {
+            zeroCopyCopied_ += hi - lo + 1;
+        }
+        ++completions;
+    }
+    if(ret < 0 || completions == 0)
+    {
+        handleError();
+    }
+}
+
 void TcpConnection::handleClose()
 {
     Utils::assertInLoopThread(loop_);
@@ -225,6 +654,12 @@ void TcpConnection::handleClose()
            state_.load() == kConnected);
     state_.store(kDisconnected);
     channel_->disableAll();
+    if(backpressureActive_)
+    {
+        // 剩余的输出不会再被写出，不能让partner一直暂停
+        backpressureActive_ = false;
+        setBackpressureTarget(false);
+    }
 
     TcpConnectionPtr guard = shared_from_this();
     connectionCallback_(guard);
@@ -232,63 +667,439 @@ void TcpConnection::handleClose()
 }
 
 void TcpConnection::sendInLoop(const void *message, size_t len)
+{
+    ssize_t nWritten = writeDirectInLoop(message, len);
+    // 没有写完的部分保存在缓冲区中，等待可写事件
+    if(nWritten >= 0 && static_cast<size_t>(nWritten) < len)
+    {
+        queueOutputInLoop(static_cast<const char*>(message) + nWritten, len - nWritten, nullptr);
+    }
+}
+
+ssize_t TcpConnection::writeDirectInLoop(const void *message, size_t len)
 {
     Utils::assertInLoopThread(loop_);
-    ssize_t nWritten = 0;
-    size_t remaining = len;
-    bool toBuffer = false;
     if(state_.load() == kDisconnected)
     {
         LOG_WARN << "disconnected, give up writing";
+        return -1;
+    }
+    if(outputBuffer_.readableBytes() > 0 || channel_->isWriting() || deferWrites())
+    {
+        return 0;
+    }
+
+    loop_->stats().countWrite();
+    ssize_t nWritten = ::write(socket_->fd(), message, len);
+    if(nWritten >= 0)
+    {
+        if(writeCompleteCallback_ && static_cast<size_t>(nWritten) == len)
+        {
+            loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+        }
+        return nWritten;
+    }
+    if (errno != EWOULDBLOCK)
+    {
+        LOG_ERROR << "TcpConnection::sendInLoop";
+        if (errno == EPIPE || errno == ECONNRESET) // FIXME: any others?
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void TcpConnection::queueOutputInLoop(const char *data, size_t len, const std::shared_ptr<const void> &owner)
+{
+    size_t oldLen = outputBuffer_.readableBytes();
+    if(owner)
+    {
+        outputBuffer_.appendShared(owner, data, len);
+    }
+    else
+    {
+        outputBuffer_.append(data, len);
+    }
+    checkHighWaterMark(oldLen);
+    updateMemoryUsage();
+    scheduleWrite();
+}
+
+void TcpConnection::sendFileInLoop(int fd, off_t offset, size_t length)
+{
+    Utils::assertInLoopThread(loop_);
+    if(state_.load() == kDisconnected)
+    {
+        LOG_WARN << "disconnected, give up sending file";
+        ::close(fd);
         return;
     }
-    
-    if(outputBuffer_.readableBytes() == 0 && !channel_->isWriting())
+
+    size_t remaining = length;
+    if(outputBuffer_.readableBytes() == 0 && !channel_->isWriting() && !deferWrites())
     {
-        nWritten = ::write(socket_->fd(), message, len);
-        if(nWritten >= 0)
+        while(remaining > 0)
+        {
+            loop_->stats().countWrite();
+            ssize_t n = ::sendfile(socket_->fd(), fd, &offset, remaining);
+            if(n == 0)
+            {
+                LOG_ERROR << "TcpConnection::sendFileInLoop - file shorter than requested";
+                remaining = 0;
+                break;
+            }
+            if(n < 0)
+            {
+                if(errno != EWOULDBLOCK)
+                {
+                    LOG_ERROR << "TcpConnection::sendFileInLoop";
+                    ::close(fd);
+                    return;
+                }
+                break;
+            }
+            remaining -= n;
+        }
+        if(remaining == 0)
         {
-            remaining = len - nWritten;
-            if(writeCompleteCallback_ && remaining == 0)
+            ::close(fd);
+            if(writeCompleteCallback_)
             {
                 loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
             }
+            return;
+        }
+    }
+
+    size_t oldLen = outputBuffer_.readableBytes();
+    outputBuffer_.appendFile(fd, offset, remaining);
+    checkHighWaterMark(oldLen);
+    updateMemoryUsage();
+    scheduleWrite();
+}
+
+void TcpConnection::sendSharedInLoop(const std::shared_ptr<const std::string>& message)
+{
+    Utils::assertInLoopThread(loop_);
+    if(state_.load() == kDisconnected)
+    {
+        LOG_WARN << "disconnected, give up writing";
+        return;
+    }
+
+    const char* data = message->data();
+    size_t remaining = message->size();
+    size_t oldLen = outputBuffer_.readableBytes();
+    // 零拷贝发送需要由输出缓冲区记录完成编号并保留引用
+    bool zeroCopy = outputBuffer_.zeroCopyThreshold() > 0 && remaining >= outputBuffer_.zeroCopyThreshold();
+    if(zeroCopy)
+    {
+        outputBuffer_.appendShared(message, data, remaining);
+    }
+    if(oldLen == 0 && !channel_->isWriting() && !deferWrites() && remaining > 0)
+    {
+        // 缓冲区原本为空时立即尝试写出，与sendInLoop的直接写入相同
+        int savedErrno = 0;
+        ssize_t n = 0;
+        loop_->stats().countWrite();
+        if(zeroCopy)
+        {
+            n = outputBuffer_.writeFd(socket_->fd(), &savedErrno);
+            remaining = outputBuffer_.readableBytes();
+        }
+        else if((n = ::write(socket_->fd(), data, remaining)) >= 0)
+        {
+            data += n;
+            remaining -= n;
         }
         else
         {
-            nWritten = 0;
-            if (errno != EWOULDBLOCK)
+            savedErrno = errno;
+        }
+        if(n < 0 && savedErrno != EWOULDBLOCK)
+        {
+            LOG_ERROR << "TcpConnection::sendSharedInLoop";
+            if(savedErrno == EPIPE || savedErrno == ECONNRESET)
+            {
+                outputBuffer_.retrieveAll();
+                return;
+            }
+        }
+        if(remaining == 0)
+        {
+            if(writeCompleteCallback_)
             {
-                LOG_ERROR << "TcpConnection::sendInLoop";
-                if (errno == EPIPE || errno == ECONNRESET) // FIXME: any others?
+                loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+            }
+            return;
+        }
+    }
+    if(remaining == 0)
+    {
+        return;
+    }
+
+    if(!zeroCopy)
+    {
+        outputBuffer_.appendShared(message, data, remaining);
+    }
+    checkHighWaterMark(oldLen);
+    updateMemoryUsage();
+    scheduleWrite();
+}
+
+void TcpConnection::sendvInLoop(const struct iovec *iov, int iovcnt, const std::shared_ptr<const void> &owner)
+{
+    Utils::assertInLoopThread(loop_);
+    if(state_.load() == kDisconnected)
+    {
+        LOG_WARN << "disconnected, give up writing";
+        return;
+    }
+
+    size_t total = 0;
+    for(int i = 0; i < iovcnt; i++)
+    {
+        total += iov[i].iov_len;
+    }
+    size_t oldLen = outputBuffer_.readableBytes();
+    size_t nWritten = 0;
+    if(oldLen == 0 && !channel_->isWriting() && !deferWrites() && total > 0)
+    {
+        loop_->stats().countWrite();
+        ssize_t n = ::writev(socket_->fd(), iov, std::min(iovcnt, IOV_MAX));
+        if(n >= 0)
+        {
+            nWritten = n;
+            if(nWritten == total)
+            {
+                if(writeCompleteCallback_)
                 {
-                    toBuffer = true;
+                    loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
                 }
+                return;
+            }
+        }
+        else if(errno != EWOULDBLOCK)
+        {
+            LOG_ERROR << "TcpConnection::sendvInLoop";
+            if(errno == EPIPE || errno == ECONNRESET)
+            {
+                return;
             }
         }
     }
+    if(nWritten == total)
+    {
+        return;
+    }
 
-    if(toBuffer)
+    // 跳过已经写出的部分，剩余的排入输出缓冲区
+    for(int i = 0; i < iovcnt; i++)
     {
-        size_t curLen = outputBuffer_.readableBytes();
-        if(curLen < highWaterMark_ &&
-           curLen + remaining >= highWaterMark_ &&
-           highWaterMarkCallback_)
+        const char* base = static_cast<const char*>(iov[i].iov_base);
+        size_t len = iov[i].iov_len;
+        size_t skip = std::min(nWritten, len);
+        nWritten -= skip;
+        if(len == skip)
+        {
+            continue;
+        }
+        if(owner)
         {
-            loop_->queueInLoop(
-                std::bind(highWaterMarkCallback_, shared_from_this(), curLen+remaining));
+            outputBuffer_.appendShared(owner, base + skip, len - skip);
         }
-        outputBuffer_.append(message, remaining);
-        if (!channel_->isWriting())
+        else
         {
-            channel_->enableWriting();
+            outputBuffer_.append(base + skip, len - skip);
         }
     }
+    checkHighWaterMark(oldLen);
+    updateMemoryUsage();
+    scheduleWrite();
+}
+
+void TcpConnection::scheduleWrite()
+{
+    if(channel_->isWriting() || corked_)
+    {
+        return;
+    }
+    if(!coalesceWrites_)
+    {
+        channel_->enableWriting();
+    }
+    else if(!flushScheduled_)
+    {
+        // loop线程投递的任务在本轮事件分发之后执行，本轮的send都已经进入缓冲区
+        flushScheduled_ = true;
+        TcpConnectionPtr guard(shared_from_this());
+        loop_->queueInLoop([guard]()
+        {
+            guard->flushScheduled_ = false;
+            guard->flushInLoop();
+        });
+    }
+}
+
+void TcpConnection::flushInLoop()
+{
+    Utils::assertInLoopThread(loop_);
+    if(corked_ || channel_->isWriting() || state_.load() == kDisconnected ||
+       outputBuffer_.readableBytes() == 0)
+    {
+        return;
+    }
+    int savedErrno = 0;
+    loop_->stats().countWrite();
+    ssize_t n = outputBuffer_.writeFd(socket_->fd(), &savedErrno);
+    if(n < 0 && savedErrno != EWOULDBLOCK)
+    {
+        LOG_ERROR << "TcpConnection::flushInLoop";
+        if(savedErrno == EPIPE || savedErrno == ECONNRESET)
+        {
+            outputBuffer_.retrieveAll();
+        }
+    }
+    updateMemoryUsage();
+    checkLowWaterMark();
+    if(outputBuffer_.readableBytes() > 0)
+    {
+        channel_->enableWriting();
+    }
+    else
+    {
+        if(n > 0 && writeCompleteCallback_)
+        {
+            writeCompleteCallback_(shared_from_this());
+        }
+        if(state_.load() == kDisconnecting)
+        {
+            shutdownInLoop();
+        }
+    }
+}
+
+void TcpConnection::checkHighWaterMark(size_t oldLen)
+{
+    size_t curLen = outputBuffer_.readableBytes();
+    if(oldLen < highWaterMark_ &&
+       curLen >= highWaterMark_ &&
+       highWaterMarkCallback_)
+    {
+        loop_->queueInLoop(
+            std::bind(highWaterMarkCallback_, shared_from_this(), curLen));
+    }
+    if(backpressureHigh_ > 0 && !backpressureActive_ && curLen >= backpressureHigh_)
+    {
+        backpressureActive_ = true;
+        setBackpressureTarget(true);
+    }
+}
+
+void TcpConnection::checkLowWaterMark()
+{
+    if(backpressureActive_ && outputBuffer_.readableBytes() <= backpressureLow_)
+    {
+        backpressureActive_ = false;
+        setBackpressureTarget(false);
+    }
+}
+
+void TcpConnection::setBackpressureTarget(bool pause)
+{
+    TcpConnectionPtr partner(backpressurePartner_.lock());
+    if(!partner)
+    {
+        // partner已经被销毁时不需要再处理
+        if(hasBackpressurePartner_)
+        {
+            return;
+        }
+        partner = shared_from_this();
+    }
+    partner->getLoop()->runInLoop([partner, pause]()
+    {
+        if(pause)
+        {
+            partner->addBackpressureSource();
+        }
+        else
+        {
+            partner->removeBackpressureSource();
+        }
+    });
+}
+
+void TcpConnection::addBackpressureSource()
+{
+    Utils::assertInLoopThread(loop_);
+    ++backpressureSources_;
+    pauseReadInLoop(kPausedByBackpressure);
+}
+
+void TcpConnection::removeBackpressureSource()
+{
+    Utils::assertInLoopThread(loop_);
+    assert(backpressureSources_ > 0);
+    // 所有以本连接为目标的输出都回落到低水位后才恢复读取
+    if(--backpressureSources_ == 0)
+    {
+        resumeReadInLoop(kPausedByBackpressure);
+    }
+}
+
+void TcpConnection::updateMemoryUsage()
+{
+    if(!memoryBudget_)
+    {
+        return;
+    }
+    size_t bytes = inputBuffer_.readableBytes() + outputBuffer_.bufferedBytes();
+    if(bytes != accountedBytes_)
+    {
+        memoryBudget_->update(static_cast<int64_t>(bytes) - static_cast<int64_t>(accountedBytes_));
+        accountedBytes_ = bytes;
+    }
+}
+
+void TcpConnection::resumeReadAfterMemoryBudget()
+{
+    Utils::assertInLoopThread(loop_);
+    resumeReadInLoop(kPausedByMemoryBudget);
+}
+
+void TcpConnection::pauseReadInLoop(int reason)
+{
+    Utils::assertInLoopThread(loop_);
+    if(readPaused_ == 0 && !reading_)
+    {
+        return;
+    }
+    readPaused_ |= reason;
+    stopReadInLoop();
+}
+
+void TcpConnection::resumeReadInLoop(int reason)
+{
+    Utils::assertInLoopThread(loop_);
+    if((readPaused_ & reason) == 0)
+    {
+        return;
+    }
+    readPaused_ &= ~reason;
+    if(readPaused_ == 0 && connected() && !reading_)
+    {
+        channel_->enableReading();
+        reading_ = true;
+    }
 }
 
 void TcpConnection::shutdownInLoop()
 {
-    if(!channel_->isWriting())
+    // 合并写入或cork时缓冲区中可能还有没开始写出的数据，由flushInLoop写完后再关闭
+    if(!channel_->isWriting() && outputBuffer_.readableBytes() == 0)
     {
         socket_->shutdownWrite();
     }
@@ -307,6 +1118,8 @@ void TcpConnection::forceCloseInLoop()
 void TcpConnection::startReadInLoop()
 {
     Utils::assertInLoopThread(loop_);
+    // 用户显式恢复读取时忽略所有自动暂停的原因
+    readPaused_ = 0;
     if(!reading_ && !channel_->isReading())
     {
         channel_->enableReading();
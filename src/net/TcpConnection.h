@@ -3,22 +3,35 @@
 #include "base/noncopyable.h"
 #include "base/Callback.h"
 #include "net/Buffer.h"
+#include "net/ChainBuffer.h"
 #include "net/InetAddress.h"
 
 #include <memory>
+#include <mutex>
 #include <atomic>
+#include <sys/types.h>
+#include <sys/uio.h>
 
 //in <netinet/tcp.h>
 struct tcp_info;
 
 class Channel;
 class EventLoop;
+class MemoryBudget;
 class Socket;
 
 class TcpConnection: noncopyable, 
                      public std::enable_shared_from_this<TcpConnection>
 {
 public:
+    /// @brief 名称在第一次调用name()时由namePrefix与id生成，建立连接时不构造字符串
+    TcpConnection(EventLoop* loop,
+                uint64_t id,
+                std::shared_ptr<const std::string> namePrefix,
+                int sockfd,
+                const InetAddress& localAddr,
+                const InetAddress& peerAddr);
+    /// @brief 使用固定的名称，id为0
     TcpConnection(EventLoop* loop,
                 const std::string& name,
                 int sockfd,
@@ -27,16 +40,51 @@ public:
     ~TcpConnection();
 
     EventLoop* getLoop() const { return loop_; }
-    const std::string& name() const { return name_; }
+    /// @brief 在所属TcpServer中唯一的id
+    uint64_t id() const { return id_; }
+    /// @brief 线程安全
+    const std::string& name() const;
     const InetAddress& localAddress() const { return localAddr_; }
     const InetAddress& peerAddress() const { return peerAddr_; }
     bool connected() const { return state_ == kConnected; }
     bool disconnected() const { return state_ == kDisconnected; }
     std::string getTcpInfoString() const;
 
+    /// 以下send都是线程安全的。在loop线程中调用时直接写入socket，没有写完的部分进入输出缓冲区；
+    /// 在其他线程中调用时，数据的所有权（或一份拷贝）随任务转移到loop线程
+
+    /// @brief 在其他线程中调用时先复制数据，调用返回后message可以被修改或释放
     void send(const void* message, int len);
     void send(const std::string& message);
-    void send(Buffer* message);  // this one will swap data
+    /// @brief 在其他线程中调用时转移message的所有权，不复制数据
+    void send(std::string&& message);
+    /// @brief 发送message中的全部可读数据，返回后message为空。
+    /// 在其他线程中调用或没有一次写完时，message的存储空间转交给连接，不复制数据，
+    /// message换成同一内存池中初始大小的空缓冲区
+    void send(Buffer&& message);
+    void send(Buffer* message) { send(std::move(*message)); }
+    /// @brief 通过writev(2)发送多段数据。owner为nullptr时数据只需在调用期间有效（其他线程中调用时会复制）；
+    /// 否则owner持有全部数据，连接保留owner的引用直到数据发送完毕，期间数据不能被修改
+    void send(const struct iovec* iov, int iovcnt, std::shared_ptr<const void> owner = nullptr);
+
+    /// @brief 发送文件fd中[offset, offset + length)的内容，排在已缓冲的数据之后，
+    /// 通过sendfile(2)直接从文件输出。调用时会复制fd，调用者可以在返回后关闭自己的fd。
+    /// 全部发送完毕后（与其他数据一样）触发writeCompleteCallback。线程安全
+    void sendFile(int fd, off_t offset, size_t length);
+
+    /// @brief 发送不可变的共享数据。输出缓冲区只保存message的引用而不复制，
+    /// 达到零拷贝阈值时通过MSG_ZEROCOPY发送。发送完成前数据不能被修改。线程安全
+    void sendShared(const std::shared_ptr<const std::string>& message);
+
+    /// @brief 不小于threshold字节的共享数据（sendShared）使用MSG_ZEROCOPY发送，0表示关闭。
+    /// 数据的引用一直保留到内核在错误队列上报告完成。内核不支持SO_ZEROCOPY时保持关闭。
+    /// 需要在connectEstablished前或loop线程中调用
+    void setZeroCopyThreshold(size_t threshold);
+    size_t zeroCopyThreshold() const { return outputBuffer_.zeroCopyThreshold(); }
+    /// @brief 内核报告完成的零拷贝发送数，以及其中退化为复制的个数（发往本机的连接总会复制）。
+    /// 只能在loop线程中读取
+    int64_t zeroCopyCompletedSends() const { return zeroCopyCompleted_; }
+    int64_t zeroCopyCopiedSends() const { return zeroCopyCopied_; }
 
     void shutdown(); // NOT thread safe, no simultaneous calling
     // void shutdownAndForceCloseAfter(double seconds); // NOT thread safe, no simultaneous calling
@@ -44,21 +92,67 @@ public:
     void forceCloseWithDelay(double seconds);
     void setTcpNoDelay(bool on);
 
+    /// @brief 合并同一轮循环中的写入：loop线程中的send不再直接写socket，只追加到输出缓冲区，
+    /// 本轮事件分发结束后（执行loop的任务队列时）每个连接只调用一次writev写出。
+    /// 一次消息回调中多次send（例如分别发送头部与正文）只需要一次系统调用。
+    /// 需要在connectEstablished前或loop线程中调用
+    void setWriteCoalescing(bool on);
+    bool writeCoalescing() const { return coalesceWrites_; }
+    /// @brief cork()之后的send只追加到输出缓冲区，直到uncork()时一次写出。
+    /// 期间调用的shutdown()也推迟到数据写出之后。线程安全，与同一线程中的send保持顺序
+    void cork();
+    void uncork();
+
+    /// @brief 使用边缘触发模式。每次读写事件都会循环读写直到EAGAIN，
+    /// 单次事件最多处理drainBudget字节，超出的部分留到下一轮循环处理。
+    /// 需要在connectEstablished前或loop线程中调用
+    void setEdgeTriggered(bool on, size_t drainBudget = kDefaultDrainBudget);
+    bool isEdgeTriggered() const;
+
+    /// @brief 读取前是否通过ioctl(FIONREAD)查询可读字节数以预留恰好的空间。
+    /// 默认根据最近的读取量估计，开启后每次读取多一次系统调用
+    void setQueryReadSize(bool on) { queryReadSize_ = on; }
+
+    static const size_t kDefaultDrainBudget = 1024*1024;
+    /// 输入缓冲区超过该容量且连接空闲时，多余的空间交还给loop的内存池
+    static const size_t kIdleShrinkCapacity = 64*1024;
+
     // reading or not
     void startRead();
     void stopRead();
     bool isReading() const { return reading_; }; // NOT thread safe, may race with start/stopReadInLoop
 
+    /// @brief 超出内存预算时的读取优先级，数值越大越晚被暂停，默认为0。见MemoryBudget
+    void setReadPriority(int priority) { readPriority_ = priority; }
+    int readPriority() const { return readPriority_; }
+    /// @brief 是否因为超出内存预算而暂停了读取。只能在loop线程中读取
+    bool isPausedByMemoryBudget() const { return (readPaused_ & kPausedByMemoryBudget) != 0; }
+
+    /// @brief 开启输出缓冲区的自动流量控制：输出缓冲区达到highWaterMark时停止读取，
+    /// 写出数据后回落到lowWaterMark以下时恢复读取。partner不为空时暂停与恢复的是partner的读取，
+    /// 用于代理中把一端连接的读取与另一端的输出关联，两端可以属于不同的loop。
+    /// 多个连接可以以同一个连接为partner，它们的输出都回落到低水位后partner才恢复读取。
+    /// 本连接关闭时恢复被暂停的读取。highWaterMark为0表示关闭。
+    /// 需要在connectEstablished前或loop线程中调用
+    void setBackpressure(size_t highWaterMark, size_t lowWaterMark,
+                         const TcpConnectionPtr& partner = TcpConnectionPtr());
+    /// @brief 是否因为（本连接或partner的）输出积压而暂停了读取。只能在loop线程中读取
+    bool isPausedByBackpressure() const { return (readPaused_ & kPausedByBackpressure) != 0; }
+
     void setConnectionCallback(const ConnectionCallback& cb) { connectionCallback_ = cb; }
     void setMessageCallback(const MessageCallback& cb) { messageCallback_ = cb; }
     void setWriteCompleteCallback(const WriteCompleteCallback& cb) { writeCompleteCallback_ = cb; }
     void setHighWaterMarkCallback(const HighWaterMarkCallback& cb, size_t highWaterMark) { highWaterMarkCallback_ = cb; highWaterMark_ = highWaterMark; }
     /// 内部使用
     void setCloseCallback(const CloseCallback& cb){ closeCallback_ = cb; }
+    /// @brief 内部使用，向budget报告缓冲区的字节数。需要在connectEstablished前调用
+    void setMemoryBudget(const std::shared_ptr<MemoryBudget>& budget) { memoryBudget_ = budget; }
+    /// @brief 内部使用，预算回落后恢复因预算暂停的读取。只能在loop线程中调用
+    void resumeReadAfterMemoryBudget();
 
     /// Advanced interface
     Buffer* inputBuffer() { return &inputBuffer_; }
-    Buffer* outputBuffer() { return &outputBuffer_; }
+    ChainBuffer* outputBuffer() { return &outputBuffer_; }
 
     // called when TcpServer accepts a new connection
     void connectEstablished();   // should be called only once
@@ -68,14 +162,66 @@ public:
 
 private:
     enum StateE {kDisconnected, kConnecting, kConnected, kDisconnecting};
+    /// 两个公开构造函数的共同实现
+    TcpConnection(EventLoop* loop,
+                uint64_t id,
+                std::shared_ptr<const std::string> namePrefix,
+                std::string name,
+                int sockfd,
+                const InetAddress& localAddr,
+                const InetAddress& peerAddr);
+    /// 自动暂停读取的原因，任一原因存在时都不读取
+    enum ReadPauseReason
+    {
+        kPausedByMemoryBudget = 1,
+        kPausedByBackpressure = 2
+    };
 
     void handleRead(Timestamp receiveTime);
+    /// @brief handleRead最后一次读取之后socket中是否已经没有数据
+    bool inputDrained(ssize_t lastRead, int savedErrno) const;
     void handleWrite();
     void handleError();
+    /// @brief 读取错误队列中的零拷贝完成通知，没有通知时按错误处理
+    void handleErrorQueue();
     void handleClose();
 
     /// @brief 尝试直接写入sockfd, 如果还有剩余, 则保存在缓冲区内并监听可写事件
     void sendInLoop(const void* message, size_t len);
+    /// @brief 输出缓冲区为空且不推迟写入时直接写入sockfd
+    /// @return 写出的字节数，没有写入时为0；连接已断开或对端已关闭时返回-1，数据应被丢弃
+    ssize_t writeDirectInLoop(const void* message, size_t len);
+    /// @brief 把没有写完的数据排入输出缓冲区并安排写出，owner不为空时只保存引用
+    void queueOutputInLoop(const char* data, size_t len, const std::shared_ptr<const void>& owner);
+    /// @brief 没有缓冲数据时直接调用sendfile，剩余部分排入输出缓冲区。获得fd的所有权
+    void sendFileInLoop(int fd, off_t offset, size_t length);
+    void sendSharedInLoop(const std::shared_ptr<const std::string>& message);
+    /// @brief 把sendSharedInLoop投递到loop线程
+    void sendSharedInLoopQueued(const std::shared_ptr<const std::string>& message);
+    /// @brief 尝试通过writev直接写入sockfd，剩余部分有owner时以引用排入输出缓冲区，否则复制
+    void sendvInLoop(const struct iovec* iov, int iovcnt, const std::shared_ptr<const void>& owner);
+    /// @brief 输出缓冲区从oldLen增长到当前大小后检查是否越过高水位，通知回调并按需暂停读取
+    void checkHighWaterMark(size_t oldLen);
+    /// @brief 合并写入或cork时不直接写socket
+    bool deferWrites() const { return coalesceWrites_ || corked_; }
+    /// @brief 输出缓冲区中有新数据后安排写出：开启可写事件，合并写入时在本轮循环末尾写出，cork时不处理
+    void scheduleWrite();
+    /// @brief 通过一次writev写出输出缓冲区，没有写完时开启可写事件
+    void flushInLoop();
+    /// @brief 输出缓冲区减少后检查是否回落到低水位，恢复流量控制暂停的读取
+    void checkLowWaterMark();
+    /// @brief 因为reason暂停读取。用户已经调用stopRead时不做处理
+    void pauseReadInLoop(int reason);
+    /// @brief 撤销reason，没有其他原因时恢复读取
+    void resumeReadInLoop(int reason);
+    /// @brief 在target所属的loop中暂停或恢复target的读取
+    void setBackpressureTarget(bool pause);
+    /// @brief 又有一个连接的输出越过高水位并以本连接为目标，暂停读取
+    void addBackpressureSource();
+    /// @brief 一个目标连接的输出回落到低水位，没有其他这样的连接时恢复读取
+    void removeBackpressureSource();
+    /// @brief 把缓冲区字节数的变化报告给内存预算
+    void updateMemoryUsage();
     void shutdownInLoop();
     void forceCloseInLoop();
     void startReadInLoop();
@@ -84,7 +230,10 @@ private:
     static const char* stateToString(int state);
 
     EventLoop* loop_;
-    std::string name_;
+    uint64_t id_;
+    std::shared_ptr<const std::string> namePrefix_; /* 为nullptr时name_在构造时给定 */
+    mutable std::string name_;
+    mutable std::once_flag nameOnce_;
     std::atomic<int> state_;
     bool reading_;
     std::unique_ptr<Socket> socket_;
@@ -98,7 +247,24 @@ private:
     CloseCallback closeCallback_;
 
     size_t highWaterMark_;
+    size_t drainBudget_;    /* 边缘触发模式下单次事件最多读写的字节数 */
+    bool queryReadSize_;
     Buffer inputBuffer_;
-    Buffer outputBuffer_;
+    ChainBuffer outputBuffer_;  /* 分块的输出缓冲区，追加时不移动已有数据 */
+    int64_t zeroCopyCompleted_;
+    int64_t zeroCopyCopied_;
+    std::shared_ptr<MemoryBudget> memoryBudget_;
+    size_t accountedBytes_;     /* 已经报告给memoryBudget_的字节数 */
+    int readPriority_;
+    int readPaused_;            /* ReadPauseReason的组合 */
+    size_t backpressureHigh_;
+    size_t backpressureLow_;
+    std::weak_ptr<TcpConnection> backpressurePartner_;
+    bool hasBackpressurePartner_;   /* 为false时暂停自己的读取 */
+    bool backpressureActive_;   /* 是否已经因为本连接的输出暂停了读取 */
+    int backpressureSources_;   /* 输出越过高水位、以本连接为目标的连接数（包括自己） */
+    bool coalesceWrites_;
+    bool corked_;
+    bool flushScheduled_;       /* 是否已经投递了本轮循环末尾的flushInLoop */
 
 };
@@ -1,37 +1,75 @@
 #include "logger/Logging.h"
 #include "net/Acceptor.h"
+#include "net/LoopGroup.h"
+#include "net/MemoryBudget.h"
 #include "net/TcpConnection.h"
 #include "net/TcpServer.h"
 #include "event/EventLoop.h"
 #include "event/EventLoopThreadPool.h"
 
 #include <functional>
+#include <future>
 #include <assert.h>
 #include <string>
 
 TcpServer::TcpServer(EventLoop *loop, const std::string &name, const InetAddress &listenAddr, Option option):
     loop_(loop),
     name_(name),
+    listenAddr_(listenAddr),
     ipPort_(listenAddr.toIpPort()),
+    option_(option),
     started_(false),
-    acceptor_(new Acceptor(loop, listenAddr, option == kReusePort)),
+    acceptor_(option == kReusePortPerLoop ? nullptr : new Acceptor(loop, listenAddr, option == kReusePort)),
     threadPool_(new EventLoopThreadPool(loop, name)),
-    nextConnId(1)
+    edgeTriggered_(false),
+    memoryBudget_(std::make_shared<MemoryBudget>()),
+    connNamePrefix_(std::make_shared<const std::string>(name_ + ipPort_)),
+    nextConnId(1),
+    acceptBatchSize_(Acceptor::kDefaultMaxAcceptsPerRead)
 {
     using namespace std::placeholders;
-    acceptor_->setNewConnectionCallback(
-        std::bind(&TcpServer::newConnection, this, _1, _2)
-    );
+    if(acceptor_)
+    {
+        acceptor_->setNewConnectionsCallback(
+            std::bind(&TcpServer::newConnections, this, _1)
+        );
+    }
 }
 
 TcpServer::~TcpServer()
 {
     Utils::assertInLoopThread(loop_);
-    for(auto& item: connections_)
+    // 连接可能同时在关闭, 只有从loop的连接表中移除连接的任务才调用connectDestroyed, 避免销毁两次
+    connections_.forEach([this](uint64_t, TcpConnectionPtr& conn)
     {
-        item.second->getLoop()->runInLoop(
-            std::bind(&TcpConnection::connectDestroyed, item.second)
-        );
+        LoopConnections* loopConns = loopConnections(conn->getLoop());
+        conn->getLoop()->runInLoop([loopConns, conn]()
+        {
+            if(loopConns->remove(conn))
+            {
+                conn->connectDestroyed();
+            }
+        });
+    });
+    // Acceptor与连接都只能在所属的loop中销毁, 等待各loop处理完后io线程才会退出
+    for(auto& item: loopAcceptors_)
+    {
+        EventLoop* ioLoop = item.first;
+        Acceptor* acceptor = item.second.release();
+        LoopConnections* loopConns = loopConnections(ioLoop);
+        std::promise<void> done;
+        ioLoop->runInLoop([acceptor, loopConns, &done]()
+        {
+            delete acceptor;
+            for(const TcpConnectionPtr& conn: loopConns->conns)
+            {
+                conn->connectDestroyed();
+            }
+            loopConns->conns.clear();
+            loopConns->index.clear();
+            done.set_value();
+        });
+        done.get_future().wait();
     }
 }
 
@@ -40,51 +78,121 @@ void TcpServer::setThreadNum(int threadNum)
     threadPool_->setNumThread(threadNum);
 }
 
+void TcpServer::setMemoryBudget(size_t limit, size_t resume)
+{
+    memoryBudget_->setLimit(limit, resume);
+}
+
+int64_t TcpServer::memoryUsage() const
+{
+    return memoryBudget_->usage();
+}
+
 void TcpServer::start()
 {
     int expect = 1;
     if(started_.compare_exchange_weak(expect, 1) == 0)
     {
-        threadPool_->start();
+        threadPool_->start(threadInitCallback_);
+        for(EventLoop* ioLoop: threadPool_->getAllLoops())
+        {
+            loopConnections_[ioLoop].reset(new LoopConnections);
+        }
+        if(option_ == kReusePortPerLoop)
+        {
+            using namespace std::placeholders;
+            for(EventLoop* ioLoop: threadPool_->getAllLoops())
+            {
+                Acceptor* acceptor = new Acceptor(ioLoop, listenAddr_, true);
+                acceptor->setMaxAcceptsPerRead(acceptBatchSize_);
+                acceptor->setNewConnectionCallback(
+                    std::bind(&TcpServer::newConnectionInLoop, this, ioLoop, _1, _2));
+                loopAcceptors_[ioLoop].reset(acceptor);
+                ioLoop->runInLoop(std::bind(&Acceptor::listen, acceptor));
+            }
+            return;
+        }
         assert(!acceptor_->listening());
+        acceptor_->setMaxAcceptsPerRead(acceptBatchSize_);
         loop_->runInLoop(
             std::bind(&Acceptor::listen, acceptor_.get())
         );
     }
 }
 
-void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr)
+void TcpServer::newConnections(const std::vector<Acceptor::AcceptedConnection> &accepted)
 {
-    Utils::assertInLoopThread(loop_);   
-    EventLoop* ioLoop = threadPool_->getNextLoop();
-    char buf[64];
-    std::string connName(name_ + ipPort_ + std::to_string(nextConnId));
-    nextConnId++;
+    Utils::assertInLoopThread(loop_);
+    // 同一个io loop的连接在一个任务中建立, 连接风暴时每个loop每批只唤醒一次
+    std::vector<TcpConnectionPtr> conns;
+    conns.reserve(accepted.size());
+    for(const Acceptor::AcceptedConnection& item: accepted)
+    {
+        EventLoop* ioLoop = threadPool_->getNextLoop();
+        TcpConnectionPtr conn(createConnection(ioLoop, item.sockfd, item.peerAddr));
+        connections_.insert(conn->id(), conn);
+        conn->setCloseCallback(
+            [this](const TcpConnectionPtr& conn)
+            {
+                loop_->runInLoop(
+                    std::bind(&TcpServer::removeConnection, this, conn)
+                );
+            });
+        conns.push_back(std::move(conn));
+    }
+    // loopConnections_在start()之后不再修改, 可以在io loop中查找
+    forEachLoopGroup(conns, [this](const TcpConnectionPtr& conn)
+    {
+        loopConnections(conn->getLoop())->add(conn);
+        conn->connectEstablished();
+    });
+}
+
+void TcpServer::newConnectionInLoop(EventLoop *ioLoop, int sockfd, const InetAddress &peerAddr)
+{
+    Utils::assertInLoopThread(ioLoop);
+    TcpConnectionPtr conn(createConnection(ioLoop, sockfd, peerAddr));
+    LoopConnections* loopConns = loopConnections(ioLoop);
+    // 连接只属于本loop, 关闭时直接在本loop中移除
+    conn->setCloseCallback([loopConns](const TcpConnectionPtr& conn)
+    {
+        conn->getLoop()->queueInLoop([loopConns, conn]()
+        {
+            if(loopConns->remove(conn))
+            {
+                conn->connectDestroyed();
+            }
+        });
+    });
+    loopConns->add(conn);
+    conn->connectEstablished();
+}
+
+TcpConnectionPtr TcpServer::createConnection(EventLoop *ioLoop, int sockfd, const InetAddress &peerAddr)
+{
+    uint64_t connId = nextConnId.fetch_add(1, std::memory_order_relaxed);
 
     LOG_INFO << "TcpServer::newConnection [" << name_
-        << "] - new connection [" << connName
+        << "] - new connection [" << *connNamePrefix_ << connId
         << "] from " << peerAddr.toIpPort();
     InetAddress localAddr(Utils::getLocalAddr(sockfd));
 
     TcpConnectionPtr conn(std::make_shared<TcpConnection>(ioLoop,
-                                                            connName,
+                                                            connId,
+                                                            connNamePrefix_,
                                                             sockfd,
                                                             localAddr,
                                                             peerAddr
                                                             ));
-
-    connections_[connName] = conn;
     conn->setConnectionCallback(connectionCallback_);
     conn->setMessageCallback(messageCallback_);
     conn->setWriteCompleteCallback(writeCompleteCallback_);
-    conn->setCloseCallback(
-        [this](const TcpConnectionPtr& conn)
-        {
-            loop_->runInLoop(
-                std::bind(&TcpServer::removeConnection, this, conn)
-            );
-        });
-    ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn));
+    if(edgeTriggered_)
+    {
+        conn->setEdgeTriggered(true);
+    }
+    conn->setMemoryBudget(memoryBudget_);
+    return conn;
 }
 
 void TcpServer::removeConnection(const TcpConnectionPtr &conn)
@@ -92,9 +200,69 @@ void TcpServer::removeConnection(const TcpConnectionPtr &conn)
     Utils::assertInLoopThread(loop_);
     LOG_INFO << "TcpServer::removeConnectionInLoop [" << name_
         << "] - connection " << conn->name();
-    connections_.erase(conn->name());
+    connections_.erase(conn->id());
+
+    LoopConnections* loopConns = loopConnections(conn->getLoop());
+    conn->getLoop()->queueInLoop([loopConns, conn]()
+    {
+        if(loopConns->remove(conn))
+        {
+            conn->connectDestroyed();
+        }
+    });
+}
+
+void TcpServer::broadcast(std::shared_ptr<const std::string> message)
+{
+    for(auto& item: loopConnections_)
+    {
+        LoopConnections* loopConns = item.second.get();
+        item.first->runInLoop([loopConns, message]()
+        {
+            // 发送失败不会在遍历过程中移除连接, 移除总是通过投递的任务进行
+            for(size_t i = 0; i < loopConns->conns.size(); i++)
+            {
+                loopConns->conns[i]->sendShared(message);
+            }
+        });
+    }
+}
 
-    conn->getLoop()->queueInLoop(
-        std::bind(&TcpConnection::connectDestroyed, conn)
-    );
+void TcpServer::sendShared(const std::vector<TcpConnectionPtr> &conns, std::shared_ptr<const std::string> message)
+{
+    forEachLoopGroup(conns, [message](const TcpConnectionPtr& conn)
+    {
+        conn->sendShared(message);
+    });
+}
+
+TcpServer::LoopConnections *TcpServer::loopConnections(EventLoop *loop) const
+{
+    auto it = loopConnections_.find(loop);
+    assert(it != loopConnections_.end());
+    return it->second.get();
+}
+
+void TcpServer::LoopConnections::add(const TcpConnectionPtr &conn)
+{
+    index[conn.get()] = conns.size();
+    conns.push_back(conn);
+}
+
+bool TcpServer::LoopConnections::remove(const TcpConnectionPtr &conn)
+{
+    auto it = index.find(conn.get());
+    if(it == index.end())
+    {
+        return false;
+    }
+    size_t pos = it->second;
+    index.erase(it);
+    if(pos != conns.size() - 1)
+    {
+        conns[pos] = std::move(conns.back());
+        index[conns[pos].get()] = pos;
+    }
+    conns.pop_back();
+    return true;
 }
@@ -1,25 +1,34 @@
 #pragma once
 
 #include "base/Callback.h"
+#include "base/IdMap.h"
+#include "net/Acceptor.h"
 #include "net/InetAddress.h"
 
 #include <atomic>
-#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
-class Acceptor;
 class EventLoop;
 class EventLoopThreadPool;
+class MemoryBudget;
 
 class TcpServer: noncopyable
 {
 private:
     using ThreadInitCallback = std::function<void(EventLoop*)>;
-    using ConnectionMap = std::map<std::string, TcpConnectionPtr>;
+    /// 以连接id为键，只在loop_中访问
+    using ConnectionMap = IdMap<TcpConnectionPtr>;
 public:
     enum Option
     {
         kNoReusePort,
-        kReusePort
+        kReusePort,
+        /// 每个io loop各有一个开启SO_REUSEPORT的Acceptor, 由内核把新连接分配给各个监听socket,
+        /// 连接在接受它的loop中直接建立, 不经过base loop. 不设置线程数时只有base loop一个Acceptor
+        kReusePortPerLoop
     };
     TcpServer(EventLoop* loop, 
               const std::string& name, 
@@ -49,16 +58,61 @@ public:
 
     void setWriteCompleteCallback(const WriteCompleteCallback& cb) { writeCompleteCallback_ = cb; }
 
+    /// @brief 新建立的连接使用边缘触发模式, 必须在start()前调用
+    void setEdgeTriggered(bool on) { edgeTriggered_ = on; }
+
+    /// @brief 每次监听socket可读时最多accept的连接数(默认16), 必须在start()前调用.
+    /// 连接风暴时一次唤醒接受多个连接, 剩余的连接留到下一轮循环
+    void setAcceptBatchSize(int n) { acceptBatchSize_ = n; }
+
+    /// @brief 所有连接的输入输出缓冲区共用limit字节的内存预算, 必须在start()前调用.
+    /// 用量超过limit后连接按读取优先级(TcpConnection::setReadPriority)依次停止读取,
+    /// 回落到resume以下后恢复. limit为0表示不限制(默认)
+    void setMemoryBudget(size_t limit, size_t resume);
+    /// @brief 当前所有连接缓冲区的字节数, 不限制预算时也会统计. 线程安全
+    int64_t memoryUsage() const;
+    std::shared_ptr<MemoryBudget> memoryBudget() const { return memoryBudget_; }
+
+    /// @brief 向所有已建立的连接发送同一份不可变数据. 每个io loop只投递一个任务,
+    /// 由该loop遍历自己的连接, 各连接的输出缓冲区只保存message的引用(TcpConnection::sendShared).
+    /// start()后线程安全
+    void broadcast(std::shared_ptr<const std::string> message);
+    /// @brief 向指定的连接发送同一份不可变数据, 按所属loop分组, 每个loop只投递一个任务. 线程安全
+    void sendShared(const std::vector<TcpConnectionPtr>& conns, std::shared_ptr<const std::string> message);
 
 private:
-    void newConnection(int sockfd, const InetAddress& peerAddr);
+    /// @brief 一个io loop上属于本服务器的连接, 只在该loop线程中访问.
+    /// 连接在connectEstablished前加入, connectDestroyed前移除, 用于广播时按loop遍历
+    struct LoopConnections
+    {
+        std::vector<TcpConnectionPtr> conns;
+        std::unordered_map<TcpConnection*, size_t> index;   /* 连接在conns中的位置 */
+
+        void add(const TcpConnectionPtr& conn);
+        /// @return 连接是否在表中, 不在表中说明已经被移除并销毁
+        bool remove(const TcpConnectionPtr& conn);
+    };
+
+    /// @brief 由loop_中的Acceptor调用, 一次可读事件中接受的连接按io loop分组, 每个loop投递一个任务建立
+    void newConnections(const std::vector<Acceptor::AcceptedConnection>& accepted);
     void removeConnection(const TcpConnectionPtr& conn);
+    /// @brief kReusePortPerLoop模式下由ioLoop自己的Acceptor调用, 在ioLoop中建立连接
+    void newConnectionInLoop(EventLoop* ioLoop, int sockfd, const InetAddress& peerAddr);
+    /// @brief 创建属于ioLoop的连接并设置除关闭回调以外的回调
+    TcpConnectionPtr createConnection(EventLoop* ioLoop, int sockfd, const InetAddress& peerAddr);
+    LoopConnections* loopConnections(EventLoop* loop) const;
 
     EventLoop* loop_; /* acceptor 所属循环 */
     std::string name_;
+    const InetAddress listenAddr_;
     std::string ipPort_;
+    const Option option_;
     std::atomic<int> started_;
-    std::unique_ptr<Acceptor> acceptor_;
+    std::unique_ptr<Acceptor> acceptor_;    /* kReusePortPerLoop模式下为nullptr */
+    /// kReusePortPerLoop模式下每个io loop的Acceptor, start()时创建, 析构时在各自的loop中销毁
+    std::unordered_map<EventLoop*, std::unique_ptr<Acceptor>> loopAcceptors_;
+    /// start()时为每个io loop创建, 之后不再修改. 需要在threadPool_之后析构
+    std::unordered_map<EventLoop*, std::unique_ptr<LoopConnections>> loopConnections_;
     std::shared_ptr<EventLoopThreadPool> threadPool_;
 
     ThreadInitCallback threadInitCallback_;
@@ -66,8 +120,13 @@ private:
     MessageCallback messageCallback_;
     WriteCompleteCallback writeCompleteCallback_;
 
-    int nextConnId;
-    ConnectionMap connections_;
+    bool edgeTriggered_;
+    std::shared_ptr<MemoryBudget> memoryBudget_;
+    /// 连接名称的前缀name_ + ipPort_，所有连接共享，名称在需要时才与id拼接
+    std::shared_ptr<const std::string> connNamePrefix_;
+    std::atomic<uint64_t> nextConnId;
+    int acceptBatchSize_;
+    ConnectionMap connections_;     /* kReusePortPerLoop模式下不使用, 连接只记录在loopConnections_中 */
 };
 
 
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+
+/// 替换全局的operator new/delete，统计整个进程的堆分配次数。
+/// 替换的函数不能是inline的，一个程序中只能有一个翻译单元（基准测试的main文件）包含本文件
+namespace AllocCounter
+{
+std::atomic<long> g_allocations(0);
+
+/// @brief 到目前为止operator new被调用的次数，可以被任意线程调用
+inline long allocations()
+{
+    return g_allocations.load(std::memory_order_relaxed);
+}
+}
+
+// operator delete被内联到new表达式所在的函数后，GCC会把其中的free误报为与operator new不匹配
+// (-Wmismatched-new-delete)，禁止内联
+
+__attribute__((noinline)) void* operator new(size_t size)
+{
+    AllocCounter::g_allocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = ::malloc(size);
+    if(p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept
+{
+    ::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept
+{
+    ::free(p);
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "base/Thread.h"
+#include "base/Timestamp.h"
+#include "event/EventLoop.h"
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+#include <assert.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+/// net测试共用的客户端工具：测试在loop线程中运行服务器，在另一个线程中用阻塞socket充当客户端
+namespace TestUtil
+{
+/// @brief 连接本机的port，失败时中止
+inline int connectServer(uint16_t port, bool noDelay = false)
+{
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if(noDelay)
+    {
+        int on = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+    }
+    int ret = ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    assert(ret == 0);
+    (void)ret;
+    return fd;
+}
+
+/// @return fd在timeoutMs内是否有events事件
+inline bool waitFor(int fd, short events, int timeoutMs)
+{
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = events;
+    return ::poll(&pfd, 1, timeoutMs) > 0;
+}
+
+/// @brief 读取len字节，out不为nullptr时保存读到的数据
+/// @return 等待数据超过timeoutMs时返回false
+inline bool readExactly(int fd, size_t len, std::string* out, int timeoutMs)
+{
+    std::vector<char> buf(64 * 1024);
+    size_t received = 0;
+    while(received < len)
+    {
+        if(!waitFor(fd, POLLIN, timeoutMs))
+        {
+            return false;
+        }
+        ssize_t n = ::read(fd, buf.data(), std::min(buf.size(), len - received));
+        if(n <= 0)
+        {
+            return false;
+        }
+        received += n;
+        if(out)
+        {
+            out->append(buf.data(), n);
+        }
+    }
+    return true;
+}
+
+/// @brief 非阻塞地写入fd，直到服务器停止读取、两端的socket缓冲区都被填满（quietMs内不可写），
+/// 或者写入了maxBytes字节
+/// @return 写入的字节数
+inline size_t flood(int fd, int quietMs = 300, size_t maxBytes = 256 * 1024 * 1024)
+{
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    std::string chunk(64 * 1024, 'f');
+    size_t sent = 0;
+    while(sent < maxBytes)
+    {
+        ssize_t n = ::write(fd, chunk.data(), std::min(chunk.size(), maxBytes - sent));
+        if(n > 0)
+        {
+            sent += n;
+        }
+        else if(!waitFor(fd, POLLOUT, quietMs))
+        {
+            break;
+        }
+    }
+    return sent;
+}
+
+/// @brief 轮询pred直到返回true，用于等待loop线程中的状态变化
+/// @return 超过timeoutMs时返回false
+template<typename Pred>
+bool waitUntil(Pred pred, int timeoutMs)
+{
+    Timestamp deadline = addTime(Timestamp::now(), timeoutMs / 1000.0);
+    while(!pred())
+    {
+        if(deadline < Timestamp::now())
+        {
+            return false;
+        }
+        ::usleep(100);
+    }
+    return true;
+}
+
+/// @brief 运行loop，loop开始后在新线程中执行client，client返回后退出loop
+inline void runClient(EventLoop* loop, std::function<void()> client)
+{
+    Thread thread([loop, client]()
+    {
+        client();
+        loop->queueInLoop([loop]() { loop->quit(); });
+    }, "client");
+    loop->runAfter(0.1, [&thread]() { thread.start(); });
+    loop->loop();
+    thread.join();
+}
+}
@@ -0,0 +1,125 @@
+#include "TestUtil.h"
+#include "base/Thread.h"
+#include "base/Timestamp.h"
+#include "event/EventLoop.h"
+#include "logger/Logging.h"
+#include "net/Buffer.h"
+#include "net/TcpConnection.h"
+#include "net/TcpServer.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+/// 接受连接的速率。多个客户端线程反复建立连接并立即以RST关闭（SO_LINGER为0，不留TIME_WAIT），
+/// 统计服务器每秒建立的连接数与每个连接的CPU时间。
+/// single:  一个Acceptor在base loop中接受连接，再投递到io loop中建立
+/// perloop: 每个io loop各有一个SO_REUSEPORT的Acceptor，连接在接受它的loop中直接建立
+/// 每种模式分别以每次可读事件accept一个连接与accept一批连接运行
+///
+/// 用法: benchAccept [numIoThreads=4] [numConns=20000] [numClientThreads=4] [acceptBatchSize=16]
+
+namespace
+{
+int g_numIoThreads = 4;
+int g_numConns = 20000;
+int g_numClientThreads = 4;
+int g_acceptBatchSize = 16;
+
+std::atomic<int> g_established(0);
+std::atomic<int> g_issued(0);
+
+double processCpuSeconds()
+{
+    struct rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+void connectLoop(uint16_t port)
+{
+    struct linger lin;
+    lin.l_onoff = 1;
+    lin.l_linger = 0;
+    while(g_issued.fetch_add(1) < g_numConns)
+    {
+        int fd = TestUtil::connectServer(port);
+        ::setsockopt(fd, SOL_SOCKET, SO_LINGER, &lin, sizeof lin);
+        ::close(fd);
+    }
+}
+
+void run(const char* name, TcpServer::Option option, uint16_t port, int batchSize)
+{
+    EventLoop loop;
+    TcpServer server(&loop, name, InetAddress(port), option);
+    server.setThreadNum(g_numIoThreads);
+    server.setAcceptBatchSize(batchSize);
+    server.setConnectionCallback([](const TcpConnectionPtr& conn)
+    {
+        if(conn->connected())
+        {
+            ++g_established;
+        }
+    });
+    server.setMessageCallback([](const TcpConnectionPtr&, Buffer* buf, Timestamp) { buf->retrieveAll(); });
+    server.start();
+
+    g_established = 0;
+    g_issued = 0;
+    double cpu = 0;
+    Timestamp start;
+    std::vector<std::unique_ptr<Thread>> clients;
+    loop.runAfter(0.1, [&]()
+    {
+        cpu = processCpuSeconds();
+        start = Timestamp::now();
+        for(int i = 0; i < g_numClientThreads; i++)
+        {
+            clients.emplace_back(new Thread(std::bind(connectLoop, port), "client"));
+            clients.back()->start();
+        }
+    });
+    loop.runEvery(0.001, [&loop]()
+    {
+        if(g_established.load() >= g_numConns)
+        {
+            loop.quit();
+        }
+    });
+    loop.loop();
+    double seconds = timeDifference(Timestamp::now(), start);
+    cpu = processCpuSeconds() - cpu;
+    for(auto& client: clients)
+    {
+        client->join();
+    }
+    printf("%-8s batch %-3d %8.0f connections/s  %.2f us cpu/connection (including clients)\n",
+           name, batchSize, g_numConns / seconds, cpu * 1e6 / g_numConns);
+    fflush(stdout);
+}
+}
+
+int main(int argc, char* argv[])
+{
+    if(argc > 1) g_numIoThreads = atoi(argv[1]);
+    if(argc > 2) g_numConns = atoi(argv[2]);
+    if(argc > 3) g_numClientThreads = atoi(argv[3]);
+    if(argc > 4) g_acceptBatchSize = atoi(argv[4]);
+    printf("%d io threads, %d connections, %d client threads\n", g_numIoThreads, g_numConns, g_numClientThreads);
+
+    // 客户端以RST关闭连接，服务器对每个连接都会记录一条ERROR日志
+    Logger::setLogLevel(Logger::FATAL);
+    run("single", TcpServer::kReusePort, 19990, 1);
+    run("single", TcpServer::kReusePort, 19990, g_acceptBatchSize);
+    run("perloop", TcpServer::kReusePortPerLoop, 19991, 1);
+    run("perloop", TcpServer::kReusePortPerLoop, 19991, g_acceptBatchSize);
+    return 0;
+}
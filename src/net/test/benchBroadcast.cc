@@ -0,0 +1,166 @@
+#include "AllocCounter.h"
+#include "TestUtil.h"
+#include "base/Thread.h"
+#include "base/Timestamp.h"
+#include "event/EventLoop.h"
+#include "logger/Logging.h"
+#include "net/Buffer.h"
+#include "net/TcpConnection.h"
+#include "net/TcpServer.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+/// 向大量连接发送同一条消息的开销。
+/// send:      发布线程对每个连接调用send(const std::string&)，每个连接投递一个任务并复制一次数据
+/// broadcast: TcpServer::broadcast，每个io loop投递一个任务，各连接只保存数据的引用
+/// 客户端线程依次从每个连接读取完整的一条消息后，发布线程再发布下一条。
+/// 统计整个进程的CPU时间与堆分配次数。
+///
+/// 用法: benchBroadcast [numConns=1000] [messageSize=1024] [numRounds=200]
+
+namespace
+{
+const uint16_t kPort = 19983;
+
+int g_numConns = 1000;
+size_t g_messageSize = 1024;
+int g_numRounds = 200;
+
+std::mutex g_mutex;
+std::vector<TcpConnectionPtr> g_conns;
+
+double processCpuSeconds()
+{
+    struct rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+bool readMessage(int fd, char* buf)
+{
+    size_t n = 0;
+    while(n < g_messageSize)
+    {
+        ssize_t r = ::read(fd, buf + n, g_messageSize - n);
+        if(r <= 0)
+        {
+            return false;
+        }
+        n += r;
+    }
+    return true;
+}
+
+void run(TcpServer* server, const std::vector<int>& fds, bool useBroadcast)
+{
+    std::shared_ptr<const std::string> message(std::make_shared<const std::string>(g_messageSize, 'm'));
+    std::vector<char> buf(g_messageSize);
+    std::vector<TcpConnectionPtr> conns;
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        conns = g_conns;
+    }
+
+    long allocations = AllocCounter::allocations();
+    double cpu = processCpuSeconds();
+    Timestamp start = Timestamp::now();
+    for(int round = 0; round < g_numRounds; round++)
+    {
+        if(useBroadcast)
+        {
+            server->broadcast(message);
+        }
+        else
+        {
+            for(const TcpConnectionPtr& conn: conns)
+            {
+                conn->send(*message);
+            }
+        }
+        for(int fd: fds)
+        {
+            if(!readMessage(fd, buf.data()))
+            {
+                fprintf(stderr, "read failed\n");
+                exit(1);
+            }
+        }
+    }
+    double seconds = timeDifference(Timestamp::now(), start);
+    cpu = processCpuSeconds() - cpu;
+    allocations = AllocCounter::allocations() - allocations;
+    double messages = static_cast<double>(g_numConns) * g_numRounds;
+    printf("%-9s  %.0f messages/s  %.2f us cpu/message  %.2f allocations/message\n",
+           useBroadcast ? "broadcast" : "send", messages / seconds, cpu * 1e6 / messages,
+           allocations / messages);
+    fflush(stdout);
+}
+
+void client(EventLoop* loop, TcpServer* server)
+{
+    std::vector<int> fds;
+    for(int i = 0; i < g_numConns; i++)
+    {
+        fds.push_back(TestUtil::connectServer(kPort));
+    }
+    while(true)
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        if(static_cast<int>(g_conns.size()) == g_numConns)
+        {
+            break;
+        }
+    }
+
+    run(server, fds, false);
+    run(server, fds, true);
+
+    for(int fd: fds)
+    {
+        ::close(fd);
+    }
+    loop->quit();
+}
+}
+
+int main(int argc, char* argv[])
+{
+    if(argc > 1) g_numConns = atoi(argv[1]);
+    if(argc > 2) g_messageSize = static_cast<size_t>(atoi(argv[2]));
+    if(argc > 3) g_numRounds = atoi(argv[3]);
+    printf("%d connections, %zu byte messages, %d rounds\n", g_numConns, g_messageSize, g_numRounds);
+
+    Logger::setLogLevel(Logger::WARN);
+    EventLoop loop;
+    TcpServer server(&loop, "Broadcast", InetAddress(kPort));
+    server.setThreadNum(2);
+    server.setConnectionCallback([](const TcpConnectionPtr& conn)
+    {
+        if(conn->connected())
+        {
+            std::lock_guard<std::mutex> lock(g_mutex);
+            g_conns.push_back(conn);
+        }
+    });
+    server.setMessageCallback([](const TcpConnectionPtr&, Buffer* buf, Timestamp) { buf->retrieveAll(); });
+    server.start();
+
+    Thread thread(std::bind(client, &loop, &server), "client");
+    loop.runAfter(0.1, [&thread]() { thread.start(); });
+    loop.loop();
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        g_conns.clear();
+    }
+    thread.join();
+    return 0;
+}
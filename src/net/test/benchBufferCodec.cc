@@ -0,0 +1,154 @@
+#include "AllocCounter.h"
+#include "base/Timestamp.h"
+#include "net/Buffer.h"
+
+#include <atomic>
+#include <new>
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+
+/// 解码二进制消息头的开销：type(4) + id(8) + key + value，key与value各带一个长度字段。
+/// fixed:  原有的readInt与retrieveAsString，每个字段单独检查长度，每个字符串一次分配
+/// reader: ByteReader一次顺序解码，长度使用varint，字符串以StringPiece的形式指向缓冲区
+/// 同时比较逐字段appendInt与beginAppend + ByteWriter的编码开销。统计每条消息的堆分配次数
+
+namespace
+{
+const int kNumMessages = 1000000;
+const int kBatch = 1000;
+const std::string kKey("user:0000000042:profile");
+const std::string kValue("{\"name\":\"muduo\",\"level\":7,\"tags\":[1,2,3]}");
+
+template<typename Func>
+void measure(const char* name, Func func)
+{
+    long allocations = AllocCounter::allocations();
+    Timestamp start = Timestamp::now();
+    size_t checksum = func();
+    double seconds = timeDifference(Timestamp::now(), start);
+    allocations = AllocCounter::allocations() - allocations;
+    printf("%-16s %7.1f ns/message  %.2f allocations/message  (checksum %zu)\n", name,
+           seconds * 1e9 / kNumMessages, static_cast<double>(allocations) / kNumMessages, checksum);
+}
+
+size_t encodeFixed(Buffer* buf)
+{
+    for(int i = 0; i < kBatch; i++)
+    {
+        buf->appendInt<int32_t>(1);
+        buf->appendInt<int64_t>(i);
+        buf->appendInt<int32_t>(static_cast<int32_t>(kKey.size()));
+        buf->append(kKey);
+        buf->appendInt<int32_t>(static_cast<int32_t>(kValue.size()));
+        buf->append(kValue);
+    }
+    return buf->readableBytes();
+}
+
+size_t encodeWriter(Buffer* buf)
+{
+    for(int i = 0; i < kBatch; i++)
+    {
+        ByteCodec::ByteWriter writer(buf->beginAppend(12 + 2 * ByteCodec::kMaxVarintLength + kKey.size() + kValue.size()));
+        writer.writeBE<uint32_t>(1);
+        writer.writeBE<uint64_t>(i);
+        writer.writeVarint(kKey.size());
+        writer.write(kKey.data(), kKey.size());
+        writer.writeVarint(kValue.size());
+        writer.write(kValue.data(), kValue.size());
+        buf->commitAppend(writer.size());
+    }
+    return buf->readableBytes();
+}
+
+size_t decodeFixed(Buffer* buf)
+{
+    size_t checksum = 0;
+    while(buf->readableBytes() > 0)
+    {
+        int32_t type = 0;
+        int64_t id = 0;
+        int32_t len = 0;
+        buf->readInt(&type);
+        buf->readInt(&id);
+        buf->readInt(&len);
+        std::string key = buf->retrieveAsString(len);
+        buf->readInt(&len);
+        std::string value = buf->retrieveAsString(len);
+        checksum += type + id + key.size() + value.size();
+    }
+    return checksum;
+}
+
+size_t decodeReader(Buffer* buf)
+{
+    size_t checksum = 0;
+    ByteCodec::ByteReader reader = buf->reader();
+    while(reader.remaining() > 0)
+    {
+        uint32_t type = reader.readBE<uint32_t>();
+        uint64_t id = reader.readBE<uint64_t>();
+        StringPiece key = reader.readView(reader.readVarint());
+        StringPiece value = reader.readView(reader.readVarint());
+        if(!reader.ok())
+        {
+            abort();
+        }
+        checksum += type + id + key.size() + value.size();
+    }
+    buf->retrieve(reader.consumed());
+    return checksum;
+}
+}
+
+int main()
+{
+    Buffer buf(1024 * 1024);
+    measure("encode fixed", [&buf]()
+    {
+        size_t bytes = 0;
+        for(int i = 0; i < kNumMessages / kBatch; i++)
+        {
+            buf.retrieveAll();
+            bytes += encodeFixed(&buf);
+        }
+        return bytes;
+    });
+    measure("encode writer", [&buf]()
+    {
+        size_t bytes = 0;
+        for(int i = 0; i < kNumMessages / kBatch; i++)
+        {
+            buf.retrieveAll();
+            bytes += encodeWriter(&buf);
+        }
+        return bytes;
+    });
+
+    Buffer fixed(1024 * 1024);
+    encodeFixed(&fixed);
+    Buffer varint(1024 * 1024);
+    encodeWriter(&varint);
+    measure("decode fixed", [&fixed]()
+    {
+        size_t checksum = 0;
+        for(int i = 0; i < kNumMessages / kBatch; i++)
+        {
+            Buffer copy(fixed);
+            checksum += decodeFixed(&copy);
+        }
+        return checksum;
+    });
+    measure("decode reader", [&varint]()
+    {
+        size_t checksum = 0;
+        for(int i = 0; i < kNumMessages / kBatch; i++)
+        {
+            Buffer copy(varint);
+            checksum += decodeReader(&copy);
+        }
+        return checksum;
+    });
+    return 0;
+}
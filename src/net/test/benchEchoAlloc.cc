@@ -0,0 +1,118 @@
+#include "AllocCounter.h"
+#include "TestUtil.h"
+#include "base/Thread.h"
+#include "event/EventLoop.h"
+#include "logger/Logging.h"
+#include "net/Buffer.h"
+#include "net/TcpConnection.h"
+#include "net/TcpServer.h"
+
+#include <atomic>
+#include <memory>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/// 统计echo服务器每条消息的堆分配次数，以及跨线程queueInLoop每个任务的堆分配次数。
+/// 替换全局operator new计数，客户端线程只使用阻塞的read/write，
+/// 预热后统计numMessages次往返期间整个进程的分配次数。
+
+namespace
+{
+const uint16_t kPort = 19981;
+const int kMessageSize = 64;
+const int kWarmup = 1000;
+const int kNumMessages = 100000;
+
+bool roundTrip(int fd, char* buf)
+{
+    if(::write(fd, buf, kMessageSize) != kMessageSize)
+    {
+        return false;
+    }
+    int n = 0;
+    while(n < kMessageSize)
+    {
+        ssize_t r = ::read(fd, buf + n, kMessageSize - n);
+        if(r <= 0)
+        {
+            return false;
+        }
+        n += static_cast<int>(r);
+    }
+    return true;
+}
+
+void increase(const std::shared_ptr<std::atomic<int>>& counter, int)
+{
+    counter->fetch_add(1, std::memory_order_release);
+}
+
+void client(EventLoop* loop)
+{
+    int fd = TestUtil::connectServer(kPort);
+
+    char buf[kMessageSize];
+    memset(buf, 'x', sizeof(buf));
+    for(int i = 0; i < kWarmup; i++)
+    {
+        roundTrip(fd, buf);
+    }
+    long before = AllocCounter::allocations();
+    for(int i = 0; i < kNumMessages; i++)
+    {
+        if(!roundTrip(fd, buf))
+        {
+            fprintf(stderr, "round trip failed\n");
+            break;
+        }
+    }
+    long after = AllocCounter::allocations();
+    printf("%d messages of %d bytes: %ld allocations, %.2f allocations/message\n",
+           kNumMessages, kMessageSize, after - before,
+           static_cast<double>(after - before) / kNumMessages);
+    fflush(stdout);
+
+    ::close(fd);
+
+    // 跨线程投递：每次投递一个绑定了shared_ptr的任务，等待其执行后再投递下一个
+    std::shared_ptr<std::atomic<int>> counter(std::make_shared<std::atomic<int>>(0));
+    before = AllocCounter::allocations();
+    for(int i = 0; i < kNumMessages; i++)
+    {
+        loop->queueInLoop(std::bind(&increase, counter, i));
+        while(counter->load(std::memory_order_acquire) <= i)
+        {
+        }
+    }
+    after = AllocCounter::allocations();
+    printf("%d cross-thread queueInLoop: %ld allocations, %.2f allocations/task\n",
+           kNumMessages, after - before,
+           static_cast<double>(after - before) / kNumMessages);
+    fflush(stdout);
+
+    loop->quit();
+}
+}
+
+int main()
+{
+    Logger::setOutput([](const char*, int) {});
+    EventLoop loop;
+    TcpServer server(&loop, "EchoAlloc", InetAddress(kPort));
+    server.setThreadNum(1);
+    server.setConnectionCallback([](const TcpConnectionPtr&) {});
+    server.setMessageCallback([](const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+    {
+        conn->send(buf);
+    });
+    server.start();
+
+    Thread thread(std::bind(client, &loop), "client");
+    loop.runAfter(0.1, [&thread]() { thread.start(); });
+    loop.loop();
+    thread.join();
+    return 0;
+}
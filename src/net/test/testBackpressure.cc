@@ -0,0 +1,214 @@
+#include "TestUtil.h"
+#include "event/EventLoop.h"
+#include "logger/Logging.h"
+#include "net/Buffer.h"
+#include "net/TcpConnection.h"
+#include "net/TcpServer.h"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <assert.h>
+#include <stdio.h>
+#include <unistd.h>
+
+/// 输出缓冲区的自动流量控制：
+/// echo:  客户端只写不读，连接的输出积压到高水位后停止读取自己
+/// relay: source的数据转发给另一个loop上的sink，sink的客户端不读，sink积压后停止读取source
+/// fanout: source的数据转发给两个sink，一个sink的客户端持续读取，另一个不读，
+///         不读的sink积压期间source保持暂停
+/// 各种情况下服务器缓冲的数据都保持在高水位附近，客户端读走数据后全部数据都被送达
+
+namespace
+{
+const uint16_t kEchoPort = 19986;
+const uint16_t kRelayPort = 19987;
+const size_t kHighWaterMark = 64 * 1024;
+const size_t kLowWaterMark = 16 * 1024;
+/// 连接在读取之后才检查水位，缓冲量可能超出高水位一次读取的大小
+const int64_t kMaxBuffered = 2 * 1024 * 1024;
+/// 两端的socket缓冲区只能容纳约10MB，source保持暂停时flood写不到这个上限
+const size_t kFanOutFloodLimit = 64 * 1024 * 1024;
+
+/// relay服务器的第一个连接是source，之后的连接都是sink
+std::mutex g_mutex;
+TcpConnectionPtr g_source;
+std::vector<TcpConnectionPtr> g_sinks;
+
+/// @brief 等待服务器一侧记录下source与numSinks个sink
+bool waitRelayConnections(size_t numSinks)
+{
+    return TestUtil::waitUntil([numSinks]()
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        return g_source != nullptr && g_sinks.size() == numSinks;
+    }, 1000);
+}
+
+void resetRelay()
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_source.reset();
+    g_sinks.clear();
+}
+
+void testEcho(TcpServer* server)
+{
+    int fd = TestUtil::connectServer(kEchoPort);
+    size_t sent = TestUtil::flood(fd);
+    int64_t buffered = server->memoryUsage();
+    printf("echo: sent %zu bytes, server buffers %ld bytes\n", sent, static_cast<long>(buffered));
+    fflush(stdout);
+    assert(buffered >= static_cast<int64_t>(kHighWaterMark) && buffered < kMaxBuffered);
+    assert(TestUtil::readExactly(fd, sent, nullptr, 2000));
+    ::close(fd);
+    printf("testEcho passed\n");
+}
+
+void testRelay(TcpServer* server)
+{
+    int source = TestUtil::connectServer(kRelayPort);
+    assert(waitRelayConnections(0));
+    int sink = TestUtil::connectServer(kRelayPort);
+    assert(waitRelayConnections(1));
+    size_t sent = TestUtil::flood(source);
+    int64_t buffered = server->memoryUsage();
+    printf("relay: sent %zu bytes, server buffers %ld bytes\n", sent, static_cast<long>(buffered));
+    fflush(stdout);
+    assert(buffered >= static_cast<int64_t>(kHighWaterMark) && buffered < kMaxBuffered);
+    assert(TestUtil::readExactly(sink, sent, nullptr, 2000));
+    ::close(source);
+    ::close(sink);
+    printf("testRelay passed\n");
+}
+
+void testFanOut(TcpServer* server)
+{
+    int source = TestUtil::connectServer(kRelayPort);
+    assert(waitRelayConnections(0));
+    int reading = TestUtil::connectServer(kRelayPort);
+    assert(waitRelayConnections(1));
+    // 缩小reading的接收缓冲区，让它的输出积压在服务器中而不是内核里
+    int rcvbuf = 32 * 1024;
+    ::setsockopt(reading, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof rcvbuf);
+    int stalled = TestUtil::connectServer(kRelayPort);
+    assert(waitRelayConnections(2));
+
+    // reading的客户端断续地读取，它的输出在高低水位之间反复，每次回落到低水位都会撤销对source的暂停
+    std::atomic<bool> stop(false);
+    std::atomic<size_t> received(0);
+    Thread reader([reading, &stop, &received]()
+    {
+        std::vector<char> buf(64 * 1024);
+        while(!stop.load())
+        {
+            if(TestUtil::waitFor(reading, POLLIN, 100))
+            {
+                ssize_t n = ::read(reading, buf.data(), buf.size());
+                assert(n > 0);
+                received += n;
+                ::usleep(5000);
+            }
+        }
+    }, "reader");
+    reader.start();
+
+    // stalled积压期间source必须保持暂停，即使reading的输出回落到低水位。
+    // 否则source随reading的读取不断恢复，flood一直写到上限
+    size_t sent = TestUtil::flood(source, 300, kFanOutFloodLimit);
+    int64_t buffered = server->memoryUsage();
+    printf("fanout: sent %zu bytes, server buffers %ld bytes\n", sent, static_cast<long>(buffered));
+    fflush(stdout);
+    assert(sent < kFanOutFloodLimit);
+    assert(buffered >= static_cast<int64_t>(kHighWaterMark) && buffered < 2 * kMaxBuffered);
+    assert(TestUtil::readExactly(stalled, sent, nullptr, 2000));
+    assert(TestUtil::waitUntil([&received, sent]() { return received.load() == sent; }, 2000));
+    stop = true;
+    reader.join();
+    ::close(source);
+    ::close(reading);
+    ::close(stalled);
+    printf("testFanOut passed\n");
+}
+
+void client(TcpServer* echo, TcpServer* relay)
+{
+    testEcho(echo);
+    testRelay(relay);
+    resetRelay();
+    testFanOut(relay);
+    resetRelay();
+}
+}
+
+int main()
+{
+    Logger::setLogLevel(Logger::WARN);
+    EventLoop loop;
+
+    TcpServer echo(&loop, "Echo", InetAddress(kEchoPort));
+    echo.setConnectionCallback([](const TcpConnectionPtr& conn)
+    {
+        if(conn->connected())
+        {
+            conn->setBackpressure(kHighWaterMark, kLowWaterMark);
+        }
+    });
+    echo.setMessageCallback([](const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+    {
+        conn->send(buf);
+    });
+    echo.start();
+
+    // source与sink分别属于不同的io loop
+    TcpServer relay(&loop, "Relay", InetAddress(kRelayPort));
+    relay.setThreadNum(3);
+    relay.setConnectionCallback([](const TcpConnectionPtr& conn)
+    {
+        if(!conn->connected())
+        {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(g_mutex);
+        if(!g_source)
+        {
+            g_source = conn;
+        }
+        else
+        {
+            conn->setBackpressure(kHighWaterMark, kLowWaterMark, g_source);
+            g_sinks.push_back(conn);
+        }
+    });
+    relay.setMessageCallback([](const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+    {
+        std::vector<TcpConnectionPtr> sinks;
+        {
+            std::lock_guard<std::mutex> lock(g_mutex);
+            if(conn == g_source)
+            {
+                sinks = g_sinks;
+            }
+        }
+        if(sinks.size() == 1)
+        {
+            sinks[0]->send(buf);
+        }
+        else if(!sinks.empty())
+        {
+            std::shared_ptr<const std::string> data(std::make_shared<const std::string>(buf->retrieveAllAsString()));
+            for(const TcpConnectionPtr& sink: sinks)
+            {
+                sink->sendShared(data);
+            }
+        }
+        else
+        {
+            buf->retrieveAll();
+        }
+    });
+    relay.start();
+
+    TestUtil::runClient(&loop, std::bind(client, &echo, &relay));
+    return 0;
+}
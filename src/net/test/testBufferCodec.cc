@@ -0,0 +1,145 @@
+#include "net/Buffer.h"
+
+#include <string>
+#include <assert.h>
+#include <stdio.h>
+
+/// Buffer上的字节序、varint、视图与预留写入
+
+namespace
+{
+void testEndian()
+{
+    Buffer buf;
+    buf.appendBE<uint32_t>(0x01020304);
+    buf.appendLE<uint16_t>(0x0506);
+    buf.appendBE<int64_t>(-2);
+    assert(buf.readableBytes() == 14);
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(buf.peek());
+    assert(p[0] == 1 && p[1] == 2 && p[2] == 3 && p[3] == 4);
+    assert(p[4] == 6 && p[5] == 5);
+    assert(buf.peekBE<uint32_t>() == 0x01020304);
+    assert(buf.peekLE<uint16_t>(4) == 0x0506);
+    assert(buf.readBE<uint32_t>() == 0x01020304);
+    assert(buf.readLE<uint16_t>() == 0x0506);
+    assert(buf.readBE<int64_t>() == -2);
+    assert(buf.readableBytes() == 0);
+    printf("testEndian passed\n");
+}
+
+void testVarint()
+{
+    const uint64_t values[] = { 0, 1, 127, 128, 300, 16383, 16384, 1ULL << 35, ~0ULL };
+    const size_t lengths[] = { 1, 1, 1, 2, 2, 2, 3, 6, 10 };
+    Buffer buf;
+    for(size_t i = 0; i < sizeof values / sizeof values[0]; i++)
+    {
+        size_t before = buf.readableBytes();
+        buf.appendVarint(values[i]);
+        assert(buf.readableBytes() - before == lengths[i]);
+        assert(ByteCodec::varintLength(values[i]) == lengths[i]);
+    }
+    for(size_t i = 0; i < sizeof values / sizeof values[0]; i++)
+    {
+        uint64_t v = 0;
+        assert(buf.readVarint(&v) == static_cast<int>(lengths[i]));
+        assert(v == values[i]);
+    }
+
+    // 不完整的varint不移动readerIndex
+    uint64_t v = 0;
+    buf.appendVarint(1ULL << 40);
+    Buffer partial;
+    partial.append(buf.peek(), 3);
+    assert(partial.readVarint(&v) == 0);
+    assert(partial.readableBytes() == 3);
+
+    // 超过10个字节是格式错误
+    Buffer bad;
+    bad.append(std::string(11, '\xff'));
+    assert(bad.readVarint(&v) == -1);
+    assert(bad.readableBytes() == 11);
+
+    Buffer signedBuf;
+    signedBuf.appendVarintSigned(-1);
+    signedBuf.appendVarintSigned(-64);
+    signedBuf.appendVarintSigned(INT64_MIN);
+    assert(signedBuf.readableBytes() == 1 + 1 + 10);
+    ByteCodec::ByteReader reader = signedBuf.reader();
+    assert(reader.readVarintSigned() == -1);
+    assert(reader.readVarintSigned() == -64);
+    assert(reader.readVarintSigned() == INT64_MIN);
+    assert(reader.ok() && reader.remaining() == 0);
+    printf("testVarint passed\n");
+}
+
+void testReaderWriter()
+{
+    // 在缓冲区中直接编码头部: type(BE32) + varint长度 + 数据
+    Buffer buf;
+    const std::string body("hello codec");
+    ByteCodec::ByteWriter writer(buf.beginAppend(4 + ByteCodec::kMaxVarintLength));
+    writer.writeBE<uint32_t>(7);
+    writer.writeVarint(body.size());
+    buf.commitAppend(writer.size());
+    assert(buf.readableBytes() == 5);
+    buf.append(body);
+
+    // 数据不完整时报告incomplete
+    for(size_t len = 0; len < buf.readableBytes(); len++)
+    {
+        ByteCodec::ByteReader reader(buf.peek(), len);
+        reader.readBE<uint32_t>();
+        uint64_t n = reader.readVarint();
+        reader.readView(n);
+        assert(reader.incomplete());
+        assert(!reader.malformed());
+    }
+
+    ByteCodec::ByteReader reader = buf.reader();
+    assert(reader.has(5));
+    assert(reader.readBE<uint32_t>() == 7);
+    uint64_t n = reader.readVarint();
+    StringPiece view = reader.readView(n);
+    assert(reader.ok());
+    assert(view == StringPiece(body));
+    assert(view.data() == buf.peek() + 5);
+    buf.retrieve(reader.consumed());
+    assert(buf.readableBytes() == 0);
+
+    // 失败后的读取返回0，并保持第一次的失败原因
+    Buffer bad;
+    bad.append(std::string(11, '\xff'));
+    ByteCodec::ByteReader badReader = bad.reader();
+    assert(badReader.readVarint() == 0);
+    assert(badReader.malformed());
+    assert(badReader.readBE<uint16_t>() == 0);
+    assert(badReader.malformed());
+    printf("testReaderWriter passed\n");
+}
+
+void testViews()
+{
+    Buffer buf;
+    buf.append(std::string("key:value"));
+    assert(buf.toStringPiece() == StringPiece("key:value"));
+    assert(buf.peekView(5, 4) == StringPiece("value"));
+    StringPiece key = buf.readView(3);
+    assert(key == StringPiece("key"));
+    assert(buf.readableBytes() == 6);
+    // 丢弃全部数据不会修改内容，视图在下一次写入前有效
+    StringPiece rest = buf.readView(6);
+    assert(rest == StringPiece(":value"));
+    assert(key == StringPiece("key"));
+    printf("testViews passed\n");
+}
+}
+
+int main()
+{
+    testEndian();
+    testVarint();
+    testReaderWriter();
+    testViews();
+    return 0;
+}
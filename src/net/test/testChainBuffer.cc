@@ -0,0 +1,280 @@
+#include "TestUtil.h"
+#include "net/Buffer.h"
+#include "net/ChainBuffer.h"
+#include "net/Socket.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+/// ChainBuffer的追加、丢弃与writev输出测试
+
+void testAppendRetrieve()
+{
+    ChainBuffer buf;
+    std::string data;
+    for(int i = 0; i < 100000; i++)
+    {
+        data.push_back(static_cast<char>('a' + i % 26));
+    }
+    // 不对齐的追加会跨越多个数据块
+    for(size_t off = 0; off < data.size(); off += 777)
+    {
+        buf.append(data.data() + off, std::min<size_t>(777, data.size() - off));
+    }
+    assert(buf.readableBytes() == data.size());
+    assert(buf.numSlabs() == (data.size() + ChainBuffer::kSlabSize - 1) / ChainBuffer::kSlabSize);
+
+    buf.retrieve(ChainBuffer::kSlabSize + 10);
+    assert(buf.readableBytes() == data.size() - ChainBuffer::kSlabSize - 10);
+    std::string rest = buf.retrieveAllAsString();
+    assert(rest == data.substr(ChainBuffer::kSlabSize + 10));
+    assert(buf.readableBytes() == 0);
+    assert(buf.numSlabs() == 0);
+    printf("testAppendRetrieve passed\n");
+}
+
+void testWriteFd()
+{
+    int fds[2];
+    if(::pipe2(fds, O_NONBLOCK) < 0)
+    {
+        perror("pipe2");
+        return;
+    }
+    ChainBuffer buf;
+    std::string data(200000, 'x');
+    for(size_t i = 0; i < data.size(); i++)
+    {
+        data[i] = static_cast<char>(i * 131);
+    }
+    buf.append(data);
+
+    // 管道容量有限，交替写出与读取直到全部数据到达
+    std::string received;
+    char tmp[65536];
+    while(received.size() < data.size())
+    {
+        int savedErrno = 0;
+        if(buf.readableBytes() > 0)
+        {
+            ssize_t n = buf.writeFd(fds[1], &savedErrno);
+            assert(n > 0 || savedErrno == EAGAIN);
+        }
+        ssize_t n = ::read(fds[0], tmp, sizeof tmp);
+        if(n > 0)
+        {
+            received.append(tmp, n);
+        }
+    }
+    assert(received == data);
+    assert(buf.readableBytes() == 0);
+    ::close(fds[0]);
+    ::close(fds[1]);
+    printf("testWriteFd passed\n");
+}
+
+void testFileSegment()
+{
+    char path[] = "/tmp/testChainBufferXXXXXX";
+    int fileFd = ::mkstemp(path);
+    assert(fileFd >= 0);
+    ::unlink(path);
+    std::string content(100000, 'f');
+    for(size_t i = 0; i < content.size(); i++)
+    {
+        content[i] = static_cast<char>(i * 7);
+    }
+    assert(::write(fileFd, content.data(), content.size()) == static_cast<ssize_t>(content.size()));
+
+    int fds[2];
+    assert(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds) == 0);
+    // 数据块、文件段、数据块依次排列，文件段只取中间的一部分
+    ChainBuffer buf;
+    buf.append(std::string("head"));
+    buf.appendFile(fileFd, 1000, 50000);
+    buf.append(std::string("tail"));
+    assert(buf.readableBytes() == 4 + 50000 + 4);
+    assert(buf.numSlabs() == 3);
+
+    std::string received;
+    char tmp[65536];
+    while(received.size() < 50008)
+    {
+        int savedErrno = 0;
+        if(buf.readableBytes() > 0)
+        {
+            ssize_t n = buf.writeFd(fds[0], &savedErrno);
+            assert(n > 0 || savedErrno == EAGAIN);
+        }
+        ssize_t n = ::read(fds[1], tmp, sizeof tmp);
+        if(n > 0)
+        {
+            received.append(tmp, n);
+        }
+    }
+    assert(received == "head" + content.substr(1000, 50000) + "tail");
+    assert(buf.readableBytes() == 0);
+    // 文件段输出完毕后fd被关闭
+    assert(::fcntl(fileFd, F_GETFD) < 0);
+    ::close(fds[0]);
+    ::close(fds[1]);
+    printf("testFileSegment passed\n");
+}
+
+void testSharedSegment()
+{
+    std::shared_ptr<const std::string> payload(std::make_shared<const std::string>(40000, 's'));
+    ChainBuffer buf;
+    buf.append(std::string("head"));
+    buf.appendShared(payload, payload->data(), payload->size());
+    buf.append(std::string("tail"));
+    assert(buf.readableBytes() == 4 + 40000 + 4);
+    assert(buf.numSlabs() == 3);
+    assert(payload.use_count() == 2);
+
+    buf.retrieve(4 + 100);
+    assert(buf.numSlabs() == 2);
+    std::string all = buf.retrieveAllAsString();
+    assert(all == std::string(39900, 's') + "tail");
+    // 共享段被释放后不再持有引用
+    assert(payload.use_count() == 1);
+
+    // 没有开启零拷贝时共享段与数据块通过同一次writev写出
+    int fds[2];
+    assert(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    buf.append(std::string("a"));
+    buf.appendShared(payload, payload->data(), 10);
+    buf.append(std::string("b"));
+    int savedErrno = 0;
+    assert(buf.writeFd(fds[0], &savedErrno) == 12);
+    char tmp[16];
+    assert(::read(fds[1], tmp, sizeof tmp) == 12);
+    assert(std::string(tmp, 12) == "assssssssssb");
+    assert(payload.use_count() == 1);
+
+    ::close(fds[0]);
+    ::close(fds[1]);
+    printf("testSharedSegment passed\n");
+}
+
+void testZeroCopy()
+{
+    int listenFd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addrLen = sizeof(addr);
+    assert(::bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+    assert(::listen(listenFd, 1) == 0);
+    assert(::getsockname(listenFd, reinterpret_cast<sockaddr*>(&addr), &addrLen) == 0);
+    int clientFd = TestUtil::connectServer(ntohs(addr.sin_port));
+    Socket sender(::accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK));
+    if(!sender.setZeroCopy(true))
+    {
+        printf("testZeroCopy skipped: SO_ZEROCOPY not supported\n");
+        ::close(clientFd);
+        ::close(listenFd);
+        return;
+    }
+
+    std::shared_ptr<const std::string> payload(std::make_shared<const std::string>(100000, 'z'));
+    ChainBuffer buf;
+    buf.setZeroCopyThreshold(50000);
+    buf.append(std::string("head"));
+    buf.appendShared(payload, payload->data(), payload->size());
+    buf.appendShared(payload, payload->data(), 10);     /* 小于阈值，普通发送 */
+
+    std::string received;
+    std::vector<char> tmp(65536);
+    int savedErrno = 0;
+    while(buf.readableBytes() > 0)
+    {
+        ssize_t written = buf.writeFd(sender.fd(), &savedErrno);
+        assert(written > 0 || savedErrno == EAGAIN);
+        ssize_t n = ::recv(clientFd, tmp.data(), tmp.size(), MSG_DONTWAIT);
+        if(n > 0)
+        {
+            received.append(tmp.data(), n);
+        }
+    }
+    // 缓冲区已经为空，但零拷贝发送完成前仍然持有数据的引用
+    assert(buf.pendingZeroCopySends() > 0);
+    assert(payload.use_count() > 1);
+    while(received.size() < 4 + 100000 + 10)
+    {
+        ssize_t n = ::read(clientFd, tmp.data(), tmp.size());
+        assert(n > 0);
+        received.append(tmp.data(), n);
+    }
+    assert(received == "head" + *payload + payload->substr(0, 10));
+
+    // 连接销毁时等待完成的发送转交给另一个缓冲区，数据的引用保留到完成通知到达
+    ChainBuffer drain;
+    size_t pending = buf.pendingZeroCopySends();
+    drain.takeZeroCopyPending(buf);
+    assert(buf.pendingZeroCopySends() == 0);
+    assert(drain.pendingZeroCopySends() == pending);
+    assert(payload.use_count() > 1);
+
+    uint32_t lo = 0;
+    uint32_t hi = 0;
+    bool copied = false;
+    while(drain.pendingZeroCopySends() > 0)
+    {
+        int ret = sender.readZeroCopyCompletion(&lo, &hi, &copied);
+        assert(ret >= 0);
+        if(ret > 0)
+        {
+            drain.handleZeroCopyCompletion(lo, hi);
+        }
+    }
+    assert(payload.use_count() == 1);
+    ::close(clientFd);
+    ::close(listenFd);
+    printf("testZeroCopy passed%s\n", copied ? " (kernel copied on loopback)" : "");
+}
+
+/// 缓冲区与内存池分离后，池被销毁（loop先于连接析构）也不影响缓冲区的使用与析构
+void testDetachPool()
+{
+    std::unique_ptr<BufferPool> pool(new BufferPool);
+    Buffer input(Buffer::kInitialSize, pool.get());
+    ChainBuffer output(pool.get());
+    input.append(std::string(3000, 'i'));
+    output.append(std::string(40000, 'o'));
+    input.detachPool();
+    output.detachPool();
+    assert(input.readableBytes() == 0);
+    assert(output.readableBytes() == 0);
+    assert(pool->cachedBytes() > 0);
+    pool.reset();
+
+    input.append(std::string(5000, 'i'));
+    output.append(std::string(20000, 'o'));
+    assert(input.retrieveAllAsString() == std::string(5000, 'i'));
+    assert(output.retrieveAllAsString() == std::string(20000, 'o'));
+    printf("testDetachPool passed\n");
+}
+
+int main()
+{
+    testAppendRetrieve();
+    testWriteFd();
+    testFileSegment();
+    testSharedSegment();
+    testZeroCopy();
+    testDetachPool();
+    return 0;
+}
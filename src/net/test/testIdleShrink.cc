@@ -0,0 +1,109 @@
+#include "TestUtil.h"
+#include "event/EventLoop.h"
+#include "logger/Logging.h"
+#include "net/Buffer.h"
+#include "net/TcpConnection.h"
+#include "net/TcpServer.h"
+
+#include <atomic>
+#include <assert.h>
+#include <stdio.h>
+#include <unistd.h>
+
+/// 输入缓冲区的空闲收缩：服务器暂停读取时客户端写入一批数据，恢复读取后一次读完并扩容。
+/// 突发流量以这样的大块读取结束，处理完之后容量也应当回落到kIdleShrinkCapacity以下。
+/// 分别以水平触发与边缘触发模式运行
+
+namespace
+{
+const uint16_t kPort = 19984;
+/// 小于初始的接收窗口，暂停读取时能够全部留在服务器的socket接收队列中
+const size_t kBurst = 60 * 1024;
+const size_t kStaleSample = static_cast<size_t>(-1);
+
+EventLoop* g_loop = nullptr;
+bool g_edgeTriggered = false;
+/// 只在loop线程中访问
+TcpConnectionPtr g_conn;
+std::atomic<size_t> g_received(0);
+std::atomic<size_t> g_capacity(0);
+std::atomic<size_t> g_maxCapacity(0);
+std::atomic<size_t> g_readHint(0);
+
+void testShrink(bool edgeTriggered)
+{
+    g_edgeTriggered = edgeTriggered;
+    g_received = 0;
+    g_capacity = 0;
+    g_maxCapacity = 0;
+    int fd = TestUtil::connectServer(kPort);
+    assert(TestUtil::waitUntil([]() { return g_capacity.load() > 0; }, 1000));
+
+    // 服务器暂停读取期间写入，恢复后数据已经全部在socket中
+    size_t sent = TestUtil::flood(fd, 300, kBurst);
+    g_loop->runInLoop([]() { g_conn->startRead(); });
+    assert(TestUtil::waitUntil([sent]() { return g_received.load() == sent; }, 2000));
+    // 丢弃突发流量之前的采样，等待loop线程重新采样
+    g_capacity = kStaleSample;
+    assert(TestUtil::waitUntil([]()
+    {
+        return g_capacity.load() <= TcpConnection::kIdleShrinkCapacity;
+    }, 1000));
+    printf("%s: sent %zu bytes, capacity %zu -> %zu\n", edgeTriggered ? "ET" : "LT",
+           sent, g_maxCapacity.load(), g_capacity.load());
+    fflush(stdout);
+    assert(g_maxCapacity.load() > TcpConnection::kIdleShrinkCapacity);
+    // 收缩后按初始的readHint读取，下一次小的读取不会立刻扩容
+    assert(g_readHint.load() == Buffer::kInitialReadHint);
+    ::close(fd);
+    assert(TestUtil::waitUntil([]() { return g_capacity.load() == 0; }, 1000));
+}
+
+void client()
+{
+    testShrink(false);
+    testShrink(true);
+    printf("testIdleShrink passed\n");
+}
+}
+
+int main()
+{
+    Logger::setLogLevel(Logger::WARN);
+    EventLoop loop;
+    g_loop = &loop;
+    TcpServer server(&loop, "IdleShrink", InetAddress(kPort));
+    server.setConnectionCallback([](const TcpConnectionPtr& conn)
+    {
+        if(conn->connected())
+        {
+            conn->setEdgeTriggered(g_edgeTriggered);
+            conn->stopRead();
+            g_conn = conn;
+        }
+        else
+        {
+            g_conn.reset();
+        }
+    });
+    server.setMessageCallback([](const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+    {
+        size_t capacity = buf->internalCapacity();
+        if(capacity > g_maxCapacity.load())
+        {
+            g_maxCapacity = capacity;
+        }
+        g_received += buf->readableBytes();
+        buf->retrieveAll();
+    });
+    // 在loop线程中采样输入缓冲区的readHint与容量，容量最后写入
+    loop.runEvery(0.01, []()
+    {
+        g_readHint = g_conn ? g_conn->inputBuffer()->readHint() : 0;
+        g_capacity = g_conn ? g_conn->inputBuffer()->internalCapacity() : 0;
+    });
+    server.start();
+
+    TestUtil::runClient(&loop, client);
+    return 0;
+}
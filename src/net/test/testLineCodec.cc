@@ -0,0 +1,108 @@
+#include "net/Buffer.h"
+#include "net/LineCodec.h"
+
+#include <string>
+#include <vector>
+#include <assert.h>
+#include <stdio.h>
+
+/// LineCodec的切分、不完整行的保留与行长度限制。不需要真实的连接，回调中不使用conn
+
+namespace
+{
+std::vector<std::string> g_lines;
+size_t g_overflow = 0;
+
+void onLine(const TcpConnectionPtr&, StringPiece line, Timestamp)
+{
+    g_lines.push_back(line.toString());
+}
+
+void onOverflow(const TcpConnectionPtr&, size_t len)
+{
+    g_overflow = len;
+}
+
+void testCRLF()
+{
+    g_lines.clear();
+    LineCodec codec(onLine);
+    Buffer buf;
+    buf.append(std::string("GET / HTTP/1.1\r\nHost: a\r\n\r\npartial"));
+    codec.onMessage(TcpConnectionPtr(), &buf, Timestamp());
+    assert(g_lines.size() == 3);
+    assert(g_lines[0] == "GET / HTTP/1.1");
+    assert(g_lines[1] == "Host: a");
+    assert(g_lines[2] == "");
+    // 不完整的行留在缓冲区中，单独的'\r'不算分隔符
+    assert(buf.readableBytes() == 7);
+    buf.append(std::string(" line\r"));
+    codec.onMessage(TcpConnectionPtr(), &buf, Timestamp());
+    assert(g_lines.size() == 3);
+    buf.append(std::string("\n"));
+    codec.onMessage(TcpConnectionPtr(), &buf, Timestamp());
+    assert(g_lines.size() == 4);
+    assert(g_lines[3] == "partial line");
+    assert(buf.readableBytes() == 0);
+    printf("testCRLF passed\n");
+}
+
+void testDelimiters()
+{
+    g_lines.clear();
+    LineCodec lf(onLine, LineCodec::kDefaultMaxLineLength, "\n");
+    Buffer buf;
+    buf.append(std::string("a\nbb\r\nccc"));
+    lf.onMessage(TcpConnectionPtr(), &buf, Timestamp());
+    assert(g_lines.size() == 2);
+    assert(g_lines[0] == "a");
+    assert(g_lines[1] == "bb\r");
+    assert(buf.readableBytes() == 3);
+
+    g_lines.clear();
+    LineCodec multi(onLine, LineCodec::kDefaultMaxLineLength, "||");
+    Buffer buf2;
+    buf2.append(std::string("x|y||z|||w|"));
+    multi.onMessage(TcpConnectionPtr(), &buf2, Timestamp());
+    assert(g_lines.size() == 2);
+    assert(g_lines[0] == "x|y");
+    assert(g_lines[1] == "z");
+    assert(std::string(buf2.peek(), buf2.readableBytes()) == "|w|");
+    printf("testDelimiters passed\n");
+}
+
+void testMaxLineLength()
+{
+    g_lines.clear();
+    LineCodec codec(onLine, 8);
+    codec.setOverflowCallback(onOverflow);
+    Buffer buf;
+    buf.append(std::string("12345678\r\n"));
+    codec.onMessage(TcpConnectionPtr(), &buf, Timestamp());
+    assert(g_lines.size() == 1);
+    assert(g_overflow == 0);
+
+    // 尚未收到分隔符的数据超过上限
+    buf.append(std::string("123456789"));
+    codec.onMessage(TcpConnectionPtr(), &buf, Timestamp());
+    assert(g_overflow == 9);
+    assert(buf.readableBytes() == 0);
+
+    // 过长的行之前的完整行仍然被处理
+    g_overflow = 0;
+    buf.append(std::string("ok\r\n0123456789\r\n"));
+    codec.onMessage(TcpConnectionPtr(), &buf, Timestamp());
+    assert(g_lines.size() == 2);
+    assert(g_lines[1] == "ok");
+    assert(g_overflow == 10);
+    printf("testMaxLineLength passed\n");
+}
+}
+
+int main()
+{
+    testCRLF();
+    testDelimiters();
+    testMaxLineLength();
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include "TestUtil.h"
+#include "event/EventLoop.h"
+#include "logger/Logging.h"
+#include "net/Buffer.h"
+#include "net/MemoryBudget.h"
+#include "net/TcpConnection.h"
+#include "net/TcpServer.h"
+
+#include <atomic>
+#include <string>
+#include <assert.h>
+#include <stdio.h>
+#include <unistd.h>
+
+/// TcpServer内存预算：echo服务器的客户端只写不读，输出缓冲区积压到超过预算后
+/// 低优先级的连接停止读取，高优先级的连接继续服务；客户端读走数据后恢复读取
+
+namespace
+{
+const uint16_t kPort = 19985;
+const size_t kLimit = 512 * 1024;
+const size_t kResume = 128 * 1024;
+
+std::atomic<int> g_numConns(0);
+/// 输入缓冲区不属于loop内存池的次数。send(buf)没有一次写完时取走buf的存储空间，
+/// 换入的缓冲区应当仍然从池中分配
+std::atomic<int> g_unpooledInputs(0);
+
+/// @brief 发送len字节并在timeoutMs内等待同样长度的回显
+bool roundTrip(int fd, size_t len, int timeoutMs)
+{
+    std::string message(len, 'r');
+    ssize_t n = ::write(fd, message.data(), message.size());
+    assert(n == static_cast<ssize_t>(len));
+    (void)n;
+    return TestUtil::readExactly(fd, len, nullptr, timeoutMs);
+}
+
+void client(TcpServer* server)
+{
+    // 按连接顺序设置优先级: flood为0, vip为4, normal为0。
+    // 连接在读取之后才检查预算，用量可能超出阈值一次读取的大小，vip的阈值留出足够的余量
+    int flood = TestUtil::connectServer(kPort);
+    assert(TestUtil::waitUntil([]() { return g_numConns.load() >= 1; }, 1000));
+    int vip = TestUtil::connectServer(kPort);
+    assert(TestUtil::waitUntil([]() { return g_numConns.load() >= 2; }, 1000));
+    int normal = TestUtil::connectServer(kPort);
+    assert(TestUtil::waitUntil([]() { return g_numConns.load() >= 3; }, 1000));
+
+    // 只写不读，直到服务器停止读取、两端的socket缓冲区都被填满
+    size_t sent = TestUtil::flood(flood);
+    int64_t usage = server->memoryUsage();
+    printf("flood sent %zu bytes, server buffers %ld bytes\n", sent, static_cast<long>(usage));
+    fflush(stdout);
+    assert(usage > static_cast<int64_t>(kLimit));
+    assert(server->memoryBudget()->overloaded());
+
+    // 高优先级的连接在更高的阈值之前继续服务
+    for(int i = 0; i < 3; i++)
+    {
+        assert(roundTrip(vip, 1024, 1000));
+    }
+    // 优先级相同的连接处理完本次读取后暂停
+    assert(roundTrip(normal, 1024, 1000));
+    assert(!roundTrip(normal, 1024, 300));
+
+    // 读走积压的回显后用量回落，暂停的连接恢复读取，全部数据最终都被回显。
+    // 服务器在写出之后才在loop线程中更新用量，客户端读完数据时预算可能还没有更新
+    assert(TestUtil::readExactly(flood, sent, nullptr, 2000));
+    assert(TestUtil::waitUntil([server]()
+    {
+        return !server->memoryBudget()->overloaded() &&
+               server->memoryUsage() < static_cast<int64_t>(kResume);
+    }, 2000));
+    // normal在暂停期间发送的数据也被处理
+    assert(TestUtil::readExactly(normal, 1024, nullptr, 1000));
+    assert(roundTrip(normal, 1024, 1000));
+
+    ::close(flood);
+    ::close(vip);
+    ::close(normal);
+    assert(TestUtil::waitUntil([server]() { return server->memoryUsage() == 0; }, 2000));
+    assert(g_unpooledInputs.load() == 0);
+    printf("testMemoryBudget passed\n");
+}
+}
+
+int main()
+{
+    Logger::setLogLevel(Logger::WARN);
+    EventLoop loop;
+    TcpServer server(&loop, "MemoryBudget", InetAddress(kPort));
+    server.setMemoryBudget(kLimit, kResume);
+    server.setConnectionCallback([](const TcpConnectionPtr& conn)
+    {
+        if(conn->connected())
+        {
+            conn->setReadPriority(g_numConns.load() == 1 ? 4 : 0);
+            ++g_numConns;
+        }
+    });
+    server.setMessageCallback([](const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+    {
+        if(buf->pool() != conn->getLoop()->bufferPool())
+        {
+            ++g_unpooledInputs;
+        }
+        conn->send(buf);
+    });
+    server.start();
+
+    TestUtil::runClient(&loop, std::bind(client, &server));
+    return 0;
+}
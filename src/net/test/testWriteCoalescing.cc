@@ -0,0 +1,130 @@
+#include "TestUtil.h"
+#include "event/EventLoop.h"
+#include "logger/Logging.h"
+#include "net/Buffer.h"
+#include "net/TcpConnection.h"
+#include "net/TcpServer.h"
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <assert.h>
+#include <stdio.h>
+#include <unistd.h>
+
+/// 写入合并与cork：
+/// 每个请求的响应分头部与正文两次send，比较逐次写入与合并写入时每个请求的write系统调用数；
+/// cork期间的send与shutdown都推迟到uncork
+
+namespace
+{
+const uint16_t kPort = 19988;
+const int kNumRequests = 2000;
+const std::string kBody(100, 'b');
+
+EventLoop* g_loop = nullptr;
+std::atomic<bool> g_coalesce(false);
+std::mutex g_mutex;
+TcpConnectionPtr g_conn;
+
+TcpConnectionPtr waitConnection()
+{
+    bool ok = TestUtil::waitUntil([]()
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        return g_conn != nullptr;
+    }, 1000);
+    assert(ok);
+    (void)ok;
+    std::lock_guard<std::mutex> lock(g_mutex);
+    TcpConnectionPtr conn;
+    conn.swap(g_conn);
+    return conn;
+}
+
+/// @return 每个请求的write系统调用数
+double requestResponse(bool coalesce)
+{
+    g_coalesce = coalesce;
+    int fd = TestUtil::connectServer(kPort, true);
+    TcpConnectionPtr conn = waitConnection();
+    int64_t writes = g_loop->statsSnapshot().writes;
+    for(int i = 0; i < kNumRequests; i++)
+    {
+        assert(::write(fd, "?", 1) == 1);
+        bool ok = TestUtil::readExactly(fd, 4 + kBody.size(), nullptr, 1000);
+        assert(ok);
+        (void)ok;
+    }
+    writes = g_loop->statsSnapshot().writes - writes;
+    ::close(fd);
+    return static_cast<double>(writes) / kNumRequests;
+}
+
+void testCork()
+{
+    g_coalesce = false;
+    int fd = TestUtil::connectServer(kPort, true);
+    TcpConnectionPtr conn = waitConnection();
+    conn->cork();
+    conn->send(std::string("one,"));
+    conn->send(std::string("two,"));
+    conn->send(std::string("three"));
+    conn->shutdown();
+    // cork期间既不写出数据，也不关闭写端
+    assert(!TestUtil::readExactly(fd, 1, nullptr, 200));
+    conn->uncork();
+    std::string received;
+    assert(TestUtil::readExactly(fd, 13, &received, 1000));
+    assert(received == "one,two,three");
+    char c;
+    assert(::read(fd, &c, 1) == 0);
+    ::close(fd);
+    printf("testCork passed\n");
+}
+
+void client()
+{
+    double plain = requestResponse(false);
+    double coalesced = requestResponse(true);
+    printf("writes/request: plain %.2f, coalesced %.2f\n", plain, coalesced);
+    assert(plain >= 1.9);
+    assert(coalesced <= 1.1);
+    printf("testCoalescing passed\n");
+    testCork();
+}
+}
+
+int main()
+{
+    Logger::setLogLevel(Logger::WARN);
+    EventLoop loop;
+    g_loop = &loop;
+    loop.setStatsEnabled(true);
+    TcpServer server(&loop, "Coalescing", InetAddress(kPort));
+    server.setConnectionCallback([](const TcpConnectionPtr& conn)
+    {
+        if(conn->connected())
+        {
+            // 关闭Nagle算法，否则分两次发送的响应要等待对端的延迟确认
+            conn->setTcpNoDelay(true);
+            conn->setWriteCoalescing(g_coalesce.load());
+            std::lock_guard<std::mutex> lock(g_mutex);
+            g_conn = conn;
+        }
+    });
+    server.setMessageCallback([](const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+    {
+        // 每个请求分别发送头部与正文
+        while(buf->readableBytes() > 0)
+        {
+            buf->retrieve(1);
+            conn->send(std::string("200 "));
+            conn->send(kBody);
+        }
+    });
+    server.start();
+
+    TestUtil::runClient(&loop, client);
+    return 0;
+}
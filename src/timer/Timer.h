@@ -10,7 +10,7 @@ class Timer: noncopyable
 {
 public:
     Timer(TimerCallback cb, Timestamp when, double interval):
-        callback_(cb),
+        callback_(std::move(cb)),
         expiration_(when),
         interval_(interval),
         repeat_(interval > 0.0),
@@ -99,7 +99,7 @@ TimerQueue::~TimerQueue()
 
 Timer* TimerQueue::addTimer(TimerCallback cb, Timestamp when, double interval)
 {
-    Timer* timer = new Timer(cb, when, interval);
+    Timer* timer = new Timer(std::move(cb), when, interval);
     loop_->runInLoop(
         std::bind(&TimerQueue::addTimerInLoop, this, timer));
     return timer;
@@ -128,8 +128,9 @@ void TimerQueue::cancelTimerInLoop(Timer *timer)
     auto ite = timers_.find(Entry(expiration, timer));
     if(ite != timers_.end()) // 定时器存在于队列中
     {
+        Timer* canceled = ite->second;
         timers_.erase(ite);
-        delete ite->second;
+        delete canceled;
     }
     /// @todo 是否真的需要cancelingTimers？
     /// 由于cancel和expire的处理都在同个线程进行，理论上不需要cancelingTimer进行同步。